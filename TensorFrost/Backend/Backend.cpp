@@ -12,6 +12,7 @@ void InitializeBackend(BackendType backendType, const string& compilerOptions, C
 
 		switch (current_backend) {
 			case BackendType::CPU:
+				WaitForBackgroundCompilations();
 				break;
 			case BackendType::Vulkan:
 				break;
@@ -34,6 +35,11 @@ void InitializeBackend(BackendType backendType, const string& compilerOptions, C
 			global_memory_manager = new CpuMemoryManager();
 			global_kernel_manager = new CpuKernelManager();
 			break;
+		case BackendType::Interpreter:
+			current_kernel_lang = CodeGenLang::CPP;
+			global_memory_manager = new CpuMemoryManager();
+			global_kernel_manager = new InterpreterKernelManager();
+			break;
 		case BackendType::Vulkan:
 			throw std::runtime_error("Vulkan backend not implemented yet");
 			current_kernel_lang = CodeGenLang::GLSL;
@@ -55,7 +61,13 @@ void CompileKernels(Program* program) {
 	for(auto& kernel : program->kernels_) {
 		switch (current_backend) {
 			case BackendType::CPU:
-				//already in the host program
+				//already in the host program, unless it is still being compiled in the background
+				if (!((CpuKernelManager*)global_kernel_manager)->HasKernelFunction(kernel.kernel_id_)) {
+					((CpuKernelManager*)global_kernel_manager)->AddInterpretedKernel(program, &kernel);
+				}
+				break;
+			case BackendType::Interpreter:
+				((InterpreterKernelManager*)global_kernel_manager)->CompileKernel(program, &kernel);
 				break;
 			case BackendType::Vulkan:
 				throw std::runtime_error("Vulkan backend not implemented yet");
@@ -68,24 +80,78 @@ void CompileKernels(Program* program) {
 	}
 }
 
+void LoadHostProgram(Program* program, size_t program_id) {
+	if (current_backend == BackendType::Interpreter) {
+		//no external compiler, the host code is interpreted
+		LoadInterpretedProgram(program);
+	} else if (current_backend == BackendType::CPU && tiered_compilation) {
+		//interpret the program until the optimized version is compiled
+		LoadInterpretedProgram(program);
+		CompileKernelModuleInBackground(program, program_id);
+	} else {
+		CompileAndLoadKernelModule(program, program_id);
+	}
+}
+
+void UpgradeHostPrograms(bool wait) {
+	InstallOptimizedModules(wait);
+}
+
+void ReleaseHostProgram(Program* program) {
+	DiscardOptimizedModule(program);
+}
+
 TFTensor Allocator(const char* name, const size_t* a, size_t dim, TFType type, void* data) {
+	TraceScope trace("allocate", "memory");
 	vector<size_t> shape(a, a + dim);
-	return *global_memory_manager->AllocateTensor(shape, type, name);
+	TFTensor tensor = *global_memory_manager->AllocateTensor(shape, type, name);
+	if (trace.Active()) {
+		trace.name = "allocate " + string(name ? name : "");
+		trace.AddArg(TraceArg("bytes", GetLinearSize(shape) * sizeof(uint32_t)));
+		trace.AddArg(TraceArg("buffer_bytes", tensor.buffer->size * sizeof(uint32_t)));
+	}
+	return tensor;
 }
 
 void Deallocator(TFTensor a, void* data) {
+	TraceScope trace("deallocate", "memory");
+	if (trace.Active()) {
+		trace.AddArg(TraceArg("bytes", GetSize(&a) * sizeof(uint32_t)));
+	}
 	global_memory_manager->DeallocateTensor(a);
 }
 
 uint Readback(TFTensor a, size_t index, void* data) {
+	TraceScope trace("readback", "transfer");
+	if (trace.Active()) {
+		trace.AddArg(TraceArg("index", index));
+		trace.AddArg(TraceArg("buffer_bytes", GetSize(&a) * sizeof(uint32_t)));
+	}
 	return global_memory_manager->ReadbackValue(&a, index);
 }
 
 void Writeback(TFTensor a, size_t index, uint32_t value, void* data) {
+	TraceScope trace("writeback", "transfer");
+	if (trace.Active()) {
+		trace.AddArg(TraceArg("index", index));
+		trace.AddArg(TraceArg("buffer_bytes", GetSize(&a) * sizeof(uint32_t)));
+	}
 	global_memory_manager->WritebackValue(&a, index, value);
 }
 
 void Dispatch(TFDispatchInfo info, void* data) {
+	TraceScope trace("dispatch", "kernel");
+	if (trace.Active()) {
+		trace.name = global_kernel_manager->GetKernel(info.kernel_id)->kernel_name_;
+		size_t bytes = 0;
+		for (size_t i = 0; i < info.read_write_count; i++) {
+			bytes += GetSize(&info.read_write_tensors[i]) * sizeof(uint32_t);
+		}
+		trace.AddArg(TraceArg("kernel_id", info.kernel_id));
+		trace.AddArg(TraceArg("work_groups", info.work_group_count));
+		trace.AddArg(TraceArg("buffers", info.read_write_count));
+		trace.AddArg(TraceArg("buffer_bytes", bytes));
+	}
 	global_kernel_manager->DispatchKernel(info);
 }
 
@@ -97,6 +163,17 @@ void Region(const char* name, bool begin, void* data) {
 			EndDebugRegion();
 		}
 	}
+
+	TraceRegion(name, begin);
+
+	if (global_kernel_manager->profiling_enabled) {
+		Program* program = (Program*)data;
+		if (begin) {
+			global_kernel_manager->BeginRegion(program, name);
+		} else {
+			global_kernel_manager->EndRegion(program, name);
+		}
+	}
 }
 
 vector<TFTensor*> ExecuteProgram(
@@ -106,6 +183,9 @@ vector<TFTensor*> ExecuteProgram(
 		throw std::runtime_error("Cannot execute program with code generation backend");
 	}
 
+	//switching between executions, so the host code and its kernels are always replaced together
+	UpgradeHostPrograms(false);
+
 	int memory_input_count = (int)program->ir_->input_memory_map.size();
 
 	if (memory_input_count != inputs.size()) {
@@ -125,7 +205,7 @@ vector<TFTensor*> ExecuteProgram(
 	TFTensor* in = input_tensors.data();
 	TFTensor* out = new TFTensor[output_count];
 
-	program->execute_callback(in, out, {Allocator, Deallocator, Readback, Writeback, Dispatch, Region, nullptr});
+	program->execute_callback(in, out, {Allocator, Deallocator, Readback, Writeback, Dispatch, Region, program});
 
 	vector<TFTensor*> outputs = vector<TFTensor*>(output_count);
 	for (int i = 0; i < output_count; i++) {
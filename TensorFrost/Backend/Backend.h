@@ -9,11 +9,13 @@
 #include <vector>
 
 #include "Backends/CPU/CPU.h"
+#include "Backends/Interpreter/Interpreter.h"
 #include "Backends/OpenGL/OpenGL.h"
 #include "CodeGen/Generators.h"
 #include "KernelManager.h"
 #include "TensorMemory.h"
 #include "RenderDoc.h"
+#include "Trace.h"
 
 namespace TensorFrost {
 
@@ -24,6 +26,7 @@ enum class BackendType {
 	Vulkan,
 	OpenGL,
 	CodeGen,
+	Interpreter,
 	NotInitialized
 };
 
@@ -45,4 +48,11 @@ void InitializeBackend(BackendType backendType, const string& compilerPath, Code
 
 void CompileKernels(Program* program);
 
+void LoadHostProgram(Program* program, size_t program_id);
+
+//install the host programs that finished compiling in the background, if wait is set wait for the rest
+void UpgradeHostPrograms(bool wait);
+
+void ReleaseHostProgram(Program* program);
+
 }  // namespace TensorFrost
\ No newline at end of file
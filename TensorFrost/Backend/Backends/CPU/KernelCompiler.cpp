@@ -1,46 +1,54 @@
 #include "KernelCompiler.h"
 
 #include <sstream>
+#include <atomic>
+#include <filesystem>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 namespace TensorFrost {
 
 std::string kernel_compile_options;
+bool tiered_compilation = false;
+std::string optimized_compile_options;
 
-bool RunCompiler(char* tempPath, char* dllName, const char* sourcePath) {
-	std::basic_stringstream<char> ss;
-
+std::string GetKernelCompileOptions() {
 #if defined(_WIN32)
 	if (kernel_compile_options.empty()) {
 #ifdef NDEBUG
-		kernel_compile_options = "/O2 /fp:fast /openmp:experimental";
+		kernel_compile_options = "/O2 /fp:fast /openmp:experimental /std:c++20";
 #else
 		kernel_compile_options = "/Zi";
 #endif
 	}
-	//what the fu..
-	ss << "powershell -command \"$VisualStudioPath = & \\\"${Env:ProgramFiles(x86)}\\Microsoft Visual Studio\\Installer\\vswhere.exe\\\" -latest -products * -property installationPath; & cmd.exe /C \\\"\"\\\"\\\"$VisualStudioPath\\VC\\Auxiliary\\Build\\vcvarsall.bat\\\"\\\" x64 && cl " 
-	   << kernel_compile_options << " /LD " << tempPath
-	   << sourcePath << " /Fe:" << dllName
-	   << "\"\"\\\"\"";  // MSVC
 #else
     if (kernel_compile_options.empty()) {
 #ifdef NDEBUG
-        kernel_compile_options = "-O3 -ffast-math -fopenmp";
+        kernel_compile_options = "-O3 -ffast-math -fopenmp -std=c++20";
 #else
         kernel_compile_options = "-g";
 #endif
     }
-    ss << "g++ " << kernel_compile_options << " -shared -fPIC " << tempPath
-       << sourcePath << " -o " << dllName;  // GCC
 #endif
+	return kernel_compile_options;
+}
 
-	
-	cout << "Compile options: " << kernel_compile_options << endl;
-	std::basic_string<char> command = ss.str();
-
-	cout << "Command: " << command << endl;
+std::string GetOptimizedCompileOptions() {
+	if (!optimized_compile_options.empty()) {
+		return optimized_compile_options;
+	}
+#if defined(_WIN32)
+	return "/O2 /fp:fast /arch:AVX2 /openmp:experimental /std:c++20";
+#else
+	return "-O3 -march=native -ffast-math -fopenmp -std=c++20";
+#endif
+}
 
-	// Run the compiler
+void RunCompilerCommand(string command) {
 #if defined(_WIN32)
 	STARTUPINFO si;
 	PROCESS_INFORMATION pi;
@@ -96,12 +104,267 @@ bool RunCompiler(char* tempPath, char* dllName, const char* sourcePath) {
 		}
 	}
 #endif
+}
+
+bool RunCompiler(const string& tempPath, const string& dllName, const string& sourcePath, const string& options,
+                 const string& libraries = "") {
+	std::basic_stringstream<char> ss;
+
+#if defined(_WIN32)
+	//what the fu..
+	ss << "powershell -command \"$VisualStudioPath = & \\\"${Env:ProgramFiles(x86)}\\Microsoft Visual Studio\\Installer\\vswhere.exe\\\" -latest -products * -property installationPath; & cmd.exe /C \\\"\"\\\"\\\"$VisualStudioPath\\VC\\Auxiliary\\Build\\vcvarsall.bat\\\"\\\" x64 && cl " 
+	   << options << " /LD " << tempPath
+	   << sourcePath << " /Fe:" << dllName
+	   << "\"\"\\\"\"";  // MSVC
+#else
+    ss << "g++ " << options << " -shared -fPIC " << tempPath
+       << sourcePath << libraries << " -o " << dllName;  // GCC
+#endif
+
+	
+	cout << "Compile options: " << options << endl;
+	std::basic_string<char> command = ss.str();
+
+	cout << "Command: " << command << endl;
+
+	RunCompilerCommand(command);
 
 	return true;
 }
 
-void CompileKernelLibrary(const string& sourceCode, char* tempPath,
-                          char* dllName, size_t program_id) {
+struct RuntimePrelude {
+	bool available = false;
+	string directory; // has the precompiled prelude header
+	string library; // TFContext implementation
+};
+
+#define PRELUDE_HEADER_NAME "tensorfrost_prelude.h"
+
+mutex prelude_mutex;
+unordered_map<string, RuntimePrelude> runtime_preludes; // by compile options
+
+#if !defined(_WIN32)
+void WriteFileAtomically(const filesystem::path& path, const string& content) {
+	filesystem::path temp = path;
+	temp += "." + to_string(getpid()) + ".tmp";
+	std::ofstream out_file(temp);
+	if (!out_file) {
+		throw std::runtime_error("Steps error: cannot write " + temp.string());
+	}
+	out_file << content;
+	out_file.close();
+	filesystem::rename(temp, path);
+}
+#endif
+
+//the prelude is compiled once per compiler options and shared between processes through the temp directory
+RuntimePrelude GetRuntimePrelude(const string& options) {
+	RuntimePrelude prelude;
+#if !defined(_WIN32)
+	lock_guard<mutex> guard(prelude_mutex);
+	if (runtime_preludes.contains(options)) {
+		return runtime_preludes[options];
+	}
+
+	string header = GetCPPHeader();
+	string implementation = GetCPPImplementation();
+	size_t key = hash<string>()(header + implementation + options);
+	filesystem::path directory = filesystem::temp_directory_path() / ("tensorfrost_prelude_" + to_string(key));
+	filesystem::path header_path = directory / PRELUDE_HEADER_NAME;
+	filesystem::path precompiled_path = directory / (PRELUDE_HEADER_NAME ".gch");
+	filesystem::path library_path = directory / "libtensorfrost_runtime.so";
+
+	try {
+		if (!filesystem::exists(precompiled_path) || !filesystem::exists(library_path)) {
+			cout << "Building the runtime prelude in " << directory.string() << endl;
+			filesystem::create_directories(directory);
+			string suffix = "." + to_string(getpid()) + ".tmp";
+			WriteFileAtomically(header_path, header);
+			WriteFileAtomically(directory / "tensorfrost_runtime.cpp", "#include \"" PRELUDE_HEADER_NAME "\"\n" + implementation);
+			RunCompilerCommand("g++ " + options + " -shared -fPIC " + (directory / "tensorfrost_runtime.cpp").string() +
+			                   " -o " + library_path.string() + suffix);
+			filesystem::rename(library_path.string() + suffix, library_path);
+			RunCompilerCommand("g++ " + options + " -fPIC -x c++-header " + header_path.string() +
+			                   " -o " + precompiled_path.string() + suffix);
+			filesystem::rename(precompiled_path.string() + suffix, precompiled_path);
+		}
+		prelude.available = true;
+		prelude.directory = directory.string();
+		prelude.library = library_path.string();
+	} catch (const std::exception& e) {
+		cerr << "Cannot build the runtime prelude, it is compiled into every program instead: " << e.what() << endl;
+	}
+	runtime_preludes[options] = prelude;
+#endif
+	return prelude;
+}
+
+#define KERNEL_SYMBOL_NAME "tf_kernel"
+
+struct KernelSource {
+	string name;
+	string code; // as it is in the program
+	string unit_code; // compiled on its own, the same kernel in another program has the same unit code
+};
+
+//the names of values, memory and variables are given by counters over the whole program,
+//so they are replaced with names local to the kernel, in the order they first appear in its code
+string GetKernelUnitCode(Kernel& kernel) {
+	unordered_set<string> names;
+	for (auto node = NodeIterator(kernel.root); !node.end(); node.next()) {
+		names.insert(node->var_name);
+	}
+	for (auto& [memory, binding] : kernel.GetMemoryBindings()) {
+		names.insert(memory->var_name);
+	}
+	for (auto& [variable, index] : kernel.variables) {
+		names.insert(variable->var_name);
+	}
+	names.erase("");
+
+	//the code generator derives these names from the names of the nodes
+	static const vector<string> prefixes = {"var_"};
+	static const vector<string> suffixes = {"_mem", "_shared", "_private", "_copies"};
+	unordered_map<string, string> local_names;
+	auto local_name = [&](const string& name) -> const string& {
+		return local_names.emplace(name, "tf_v" + to_string(local_names.size())).first->second;
+	};
+	auto rename = [&](const string& token) -> string {
+		if (names.contains(token)) {
+			return local_name(token);
+		}
+		for (const string& prefix : prefixes) {
+			if (token.starts_with(prefix) && names.contains(token.substr(prefix.size()))) {
+				return prefix + local_name(token.substr(prefix.size()));
+			}
+		}
+		for (const string& suffix : suffixes) {
+			if (token.ends_with(suffix) && names.contains(token.substr(0, token.size() - suffix.size()))) {
+				return local_name(token.substr(0, token.size() - suffix.size())) + suffix;
+			}
+		}
+		return token;
+	};
+
+	//the kernel id is not part of the code either
+	string code = kernel.full_generated_code_;
+	size_t name_position = code.find(kernel.kernel_name_ + "(");
+	if (name_position == string::npos) {
+		throw std::runtime_error("Steps error: cannot find kernel function " + kernel.kernel_name_);
+	}
+	code.replace(name_position, kernel.kernel_name_.size(), KERNEL_SYMBOL_NAME);
+
+	string unit_code = "#include \"" PRELUDE_HEADER_NAME "\"\n";
+	for (size_t i = 0; i < code.size();) {
+		if (!isalnum((unsigned char)code[i]) && code[i] != '_') {
+			unit_code += code[i++];
+			continue;
+		}
+		size_t end = i;
+		while (end < code.size() && (isalnum((unsigned char)code[end]) || code[end] == '_')) {
+			end++;
+		}
+		string token = code.substr(i, end - i);
+		unit_code += isdigit((unsigned char)token[0]) ? token : rename(token);
+		i = end;
+	}
+	return unit_code;
+}
+
+//the kernel functions of a program, in the order they appear in its generated code
+vector<KernelSource> GetKernelSources(Program* program) {
+	vector<KernelSource> kernels;
+	if (current_backend == BackendType::CPU) {
+		for (auto& kernel : program->kernels_) {
+			kernels.push_back({kernel.kernel_name_, kernel.full_generated_code_, GetKernelUnitCode(kernel)});
+		}
+	}
+	return kernels;
+}
+
+atomic<size_t> kernel_build_counter = 0; //keeps the temporary files of concurrent builds apart
+
+//run the jobs on a pool of threads, each job waits for its own compiler process
+void RunCompilerJobs(const vector<function<void()>>& jobs) {
+	size_t thread_count = min<size_t>(jobs.size(), max(1u, thread::hardware_concurrency()));
+	atomic<size_t> next_job = 0;
+	string error;
+	mutex error_mutex;
+	auto worker = [&]() {
+		while (true) {
+			size_t job = next_job.fetch_add(1);
+			if (job >= jobs.size()) break;
+			try {
+				jobs[job]();
+			} catch (const std::exception& e) {
+				lock_guard<mutex> guard(error_mutex);
+				if (error.empty()) error = e.what();
+			}
+		}
+	};
+	vector<thread> threads;
+	for (size_t i = 1; i < thread_count; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (thread& t : threads) {
+		t.join();
+	}
+	if (!error.empty()) {
+		throw std::runtime_error(error);
+	}
+}
+
+#if !defined(_WIN32)
+//compiles every kernel into its own library, cached by the hash of its code in the prelude directory, returns the libraries in kernel order
+vector<string> CompileKernelUnits(const vector<KernelSource>& kernels, const RuntimePrelude& prelude,
+                                  const string& options, vector<function<void()>>& jobs) {
+	vector<string> libraries;
+	filesystem::path directory = filesystem::path(prelude.directory) / "kernels";
+	filesystem::create_directories(directory);
+	unordered_set<string> scheduled;
+	for (const KernelSource& kernel : kernels) {
+		const string& unit_code = kernel.unit_code;
+		string unit_name = "kernel_" + to_string(hash<string>()(unit_code));
+		filesystem::path library_path = directory / (unit_name + ".so");
+		libraries.push_back(library_path.string());
+		if (filesystem::exists(library_path) || scheduled.contains(unit_name)) {
+			continue;
+		}
+		scheduled.insert(unit_name);
+
+		jobs.push_back([unit_code, library_path, source_path = directory / (unit_name + ".cpp"), prelude, options]() {
+			string suffix = "." + to_string(getpid()) + "_" + to_string(kernel_build_counter++) + ".tmp";
+			filesystem::path temp_source = source_path;
+			temp_source.replace_extension(suffix + ".cpp");
+			std::ofstream out_file(temp_source);
+			if (!out_file) {
+				throw std::runtime_error("Steps error: cannot write " + temp_source.string());
+			}
+			out_file << unit_code;
+			out_file.close();
+			try {
+				RunCompilerCommand("g++ " + options + " -I" + prelude.directory + " -shared -fPIC " + temp_source.string() + " " +
+				                   prelude.library + " -Wl,-rpath," + prelude.directory + " -o " + library_path.string() + suffix);
+			} catch (...) {
+				//do not leave the files of a failed compilation in the cache directory
+				error_code ignored;
+				filesystem::remove(temp_source, ignored);
+				filesystem::remove(library_path.string() + suffix, ignored);
+				throw;
+			}
+			filesystem::rename(temp_source, source_path);
+			filesystem::rename(library_path.string() + suffix, library_path);
+		});
+	}
+	cout << "Compiling " << jobs.size() << " kernels, " << kernels.size() - jobs.size() << " found in the cache" << endl;
+	return libraries;
+}
+#endif
+
+//returns the kernel libraries if the kernels were compiled separately, otherwise they are in the program library
+vector<string> CompileKernelLibrary(const string& sourceCode, const vector<KernelSource>& kernels, const string& tempPath,
+                                    const string& dllName, size_t program_id, const string& options) {
 	// Append a file name to the tempPath
 	std::string source_name = "generated_lib_" + std::to_string(program_id) + ".cpp";
 	std::basic_stringstream<char> ss;
@@ -112,22 +375,54 @@ void CompileKernelLibrary(const string& sourceCode, char* tempPath,
 
 	cout << "Source path: " << file_path << endl;
 
+	//use the prebuilt prelude instead of compiling it again
+	string prelude_source = GetCPPHeader() + GetCPPImplementation();
+	string program_options = options;
+	string libraries;
+	string program_code = sourceCode;
+	vector<string> kernel_libraries;
+	vector<function<void()>> jobs;
+	if (sourceCode.compare(0, prelude_source.size(), prelude_source) == 0) {
+		RuntimePrelude prelude = GetRuntimePrelude(options);
+		if (prelude.available) {
+			program_code = "#include \"" PRELUDE_HEADER_NAME "\"\n" + sourceCode.substr(prelude_source.size());
+			program_options += " -I" + prelude.directory;
+			libraries = " " + prelude.library + " -Wl,-rpath," + prelude.directory;
+
+#if !defined(_WIN32)
+			//the kernels are compiled as separate units, so that a changed program only recompiles the kernels that changed
+			if (!kernels.empty()) {
+				kernel_libraries = CompileKernelUnits(kernels, prelude, options, jobs);
+				for (const KernelSource& kernel : kernels) {
+					size_t position = program_code.find(kernel.code);
+					if (position == string::npos) {
+						throw std::runtime_error("Steps error: cannot find kernel function " + kernel.name);
+					}
+					program_code.erase(position, kernel.code.size());
+				}
+			}
+#endif
+		}
+	}
+
 	// Write the generated source code to a file
 	std::ofstream out_file(file_path);
 	if (!out_file) {
 		throw std::runtime_error(
 		    "Steps error: cannot open file for writing generated source code");
 	}
-	out_file << sourceCode;
+	out_file << program_code;
 	out_file.close();
 
-	RunCompiler(tempPath, dllName, source_name.c_str());
+	jobs.push_back([&]() { RunCompiler(tempPath, dllName, source_name, program_options, libraries); });
+	RunCompilerJobs(jobs);
+	return kernel_libraries;
 }
 
-void CompileAndLoadKernelModule(Program* program, size_t program_id) {
+void GetTempLibraryName(string& temp_path, string& library_name) {
 #if defined(_WIN32)
-	char temp_path[MAX_PATH];
-	DWORD path_length = GetTempPath(MAX_PATH, temp_path);
+	char temp_dir[MAX_PATH];
+	DWORD path_length = GetTempPath(MAX_PATH, temp_dir);
 
 	if (path_length == 0) {
 		throw std::runtime_error("Steps error: cannot get temp path");
@@ -135,48 +430,68 @@ void CompileAndLoadKernelModule(Program* program, size_t program_id) {
 
 	// Create a temporary library name
 	char temp_file_name[MAX_PATH];
-	if (!GetTempFileName(temp_path, TEXT("lib"), 0, temp_file_name)) {
+	if (!GetTempFileName(temp_dir, TEXT("lib"), 0, temp_file_name)) {
 		throw std::runtime_error("Steps error: cannot create temp file");
 	}
+	temp_path = temp_dir;
 #else
-	char temp_path[] = "/tmp/";
 	char filename_template[] = "/tmp/tensorfrost_XXXXXX";
 	char* temp_file_name = mktemp(filename_template);
 	if (!temp_file_name) {
 		throw std::runtime_error("Steps error: cannot create temp file");
 	}
+	temp_path = "/tmp/";
 #endif
+	library_name = temp_file_name;
 
-	cout << "Temp file: " << temp_file_name << endl;
-
-	// Compile the library
-	CompileKernelLibrary(program->generated_code_, temp_path, temp_file_name, program_id);
+	cout << "Temp file: " << library_name << endl;
+}
 
+void LoadKernelLibrary(Program* program, const string& library_name, const vector<string>& kernel_libraries = {}) {
 	// Load the library
 	#if defined(_WIN32)
-	HMODULE lib_handle = LoadLibrary(temp_file_name);
+	HMODULE lib_handle = LoadLibrary(library_name.c_str());
 	if (!lib_handle) {
 		throw std::runtime_error("Steps error: cannot load generated library");
 	}
 	#else
-	void* lib_handle = dlopen(temp_file_name, RTLD_LAZY);
+	void* lib_handle = dlopen(library_name.c_str(), RTLD_LAZY);
 	if (!lib_handle) {
 		throw std::runtime_error("Steps error: cannot load generated library");
 	}
+
+	//kernels compiled as separate units each have their own library
+	vector<void*> kernel_handles;
+	for (const string& kernel_library : kernel_libraries) {
+		void* kernel_handle = dlopen(kernel_library.c_str(), RTLD_LAZY);
+		if (!kernel_handle) {
+			for (void* handle : kernel_handles) dlclose(handle);
+			dlclose(lib_handle);
+			throw std::runtime_error("Steps error: cannot load kernel library " + kernel_library);
+		}
+		kernel_handles.push_back(kernel_handle);
+	}
 	#endif
 
 	// Create lambda function to free the library
+	#if defined(_WIN32)
 	program->unload_callback = [lib_handle]() {
-		#if defined(_WIN32)
 		if (!FreeLibrary(lib_handle)) {
 			std::cerr << "Cannot free library: " << GetLastError() << '\n';
 		}
-		#else
+	};
+	#else
+	program->unload_callback = [lib_handle, kernel_handles]() {
 		if (dlclose(lib_handle)) {
 			std::cerr << "Cannot free library: " << dlerror() << '\n';
 		}
-		#endif
+		for (void* handle : kernel_handles) {
+			if (dlclose(handle)) {
+				std::cerr << "Cannot free library: " << dlerror() << '\n';
+			}
+		}
 	};
+	#endif
 
 	// Load the main function
 	#if defined(_WIN32)
@@ -191,10 +506,8 @@ void CompileAndLoadKernelModule(Program* program, size_t program_id) {
 		throw std::runtime_error("Steps error: cannot load main function");
 	}
 
-	// Set the execute callback
-	program->execute_callback = *main_callback;
-
 	// load cpu kernel functions
+	vector<cpu_dispatch_func*> kernel_callbacks;
 	if (current_backend == BackendType::CPU)
 	{
 		for (auto& kernel : program->kernels_) {
@@ -202,22 +515,179 @@ void CompileAndLoadKernelModule(Program* program, size_t program_id) {
 			auto kernel_callback = reinterpret_cast<cpu_dispatch_func*>(
 				GetProcAddress(lib_handle, kernel.kernel_name_.c_str()));
 			#else
-			auto kernel_callback = reinterpret_cast<cpu_dispatch_func*>(
-				dlsym(lib_handle, kernel.kernel_name_.c_str()));
+			size_t kernel_index = kernel_callbacks.size();
+			auto kernel_callback = reinterpret_cast<cpu_dispatch_func*>(kernel_handles.empty() ?
+				dlsym(lib_handle, kernel.kernel_name_.c_str()) : dlsym(kernel_handles[kernel_index], KERNEL_SYMBOL_NAME));
 			#endif
 
 			if (!kernel_callback) {
 				throw std::runtime_error("Steps error: cannot load kernel function");
 			}
+			kernel_callbacks.push_back(kernel_callback);
+		}
+	}
 
-			((CpuKernelManager*)global_kernel_manager)
-			    ->AddKernelFunction(&kernel, kernel_callback);
+	// Set the execute callback and the kernels together, so that the host code always matches its kernels
+	program->execute_callback = *main_callback;
+	for (size_t i = 0; i < kernel_callbacks.size(); i++) {
+		Kernel& kernel = program->kernels_[i];
+		((CpuKernelManager*)global_kernel_manager)
+		    ->AddKernelFunction(&kernel, kernel_callbacks[i]);
 
-			cout << "Loaded kernel: " << kernel.kernel_name_ << endl;
-		}
+		cout << "Loaded kernel: " << kernel.kernel_name_ << endl;
 	}
+}
+
+void CompileAndLoadKernelModule(Program* program, size_t program_id) {
+	string temp_path, library_name;
+	GetTempLibraryName(temp_path, library_name);
+
+	// Compile the library
+	auto compile_start = std::chrono::high_resolution_clock::now();
+	vector<string> kernel_libraries = CompileKernelLibrary(program->generated_code_, GetKernelSources(program), temp_path, library_name,
+	                                                       program_id, GetKernelCompileOptions());
+	auto compile_end = std::chrono::high_resolution_clock::now();
+	program->host_compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(compile_end - compile_start).count() / 1000000.0f;
+
+	LoadKernelLibrary(program, library_name, kernel_libraries);
+
+	auto load_end = std::chrono::high_resolution_clock::now();
+	program->library_load_time = std::chrono::duration_cast<std::chrono::nanoseconds>(load_end - compile_end).count() / 1000000.0f;
 
 	cout << "Successfully compiled and loaded kernel library." << endl;
 }
 
-}  // namespace TensorFrost
+struct OptimizedModule {
+	Program* program;
+	string library_name;
+	vector<string> kernel_libraries;
+	float compile_time = 0.0f;
+	string error;
+	bool finished = false;
+	bool discarded = false;
+};
+
+mutex optimized_modules_mutex;
+condition_variable optimized_module_finished;
+vector<shared_ptr<OptimizedModule>> optimized_modules;
+atomic<int> finished_optimized_modules = 0; //checked before every execution without locking
+
+//a joinable thread must not be destroyed, so the compilations still running at exit are waited for
+struct BackgroundCompilations {
+	vector<thread> threads;
+
+	~BackgroundCompilations() {
+		for (thread& compilation : threads) {
+			if (compilation.joinable()) compilation.join();
+		}
+	}
+};
+
+BackgroundCompilations background_compilations;
+
+void CompileKernelModuleInBackground(Program* program, size_t program_id) {
+	string temp_path, library_name;
+	GetTempLibraryName(temp_path, library_name);
+
+	shared_ptr<OptimizedModule> module = make_shared<OptimizedModule>();
+	module->program = program;
+	module->library_name = library_name;
+	{
+		lock_guard<mutex> guard(optimized_modules_mutex);
+		optimized_modules.push_back(module);
+	}
+
+	//the thread only works on copies, the program is touched again when the module is installed
+	thread compilation([module, source = program->generated_code_, kernels = GetKernelSources(program), temp_path, program_id,
+	        options = GetOptimizedCompileOptions()]() {
+		auto compile_start = std::chrono::high_resolution_clock::now();
+		try {
+			module->kernel_libraries = CompileKernelLibrary(source, kernels, temp_path, module->library_name, program_id, options);
+		} catch (const std::exception& e) {
+			module->error = e.what();
+		}
+		auto compile_end = std::chrono::high_resolution_clock::now();
+		module->compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(compile_end - compile_start).count() / 1000000.0f;
+
+		lock_guard<mutex> guard(optimized_modules_mutex);
+		module->finished = true;
+		if (!module->discarded) {
+			finished_optimized_modules++;
+		}
+		optimized_module_finished.notify_all();
+	});
+
+	lock_guard<mutex> guard(optimized_modules_mutex);
+	background_compilations.threads.push_back(std::move(compilation));
+}
+
+void WaitForBackgroundCompilations() {
+	vector<thread> threads;
+	{
+		//the threads lock the mutex when they finish, so they are joined outside of it
+		lock_guard<mutex> guard(optimized_modules_mutex);
+		threads = std::move(background_compilations.threads);
+		background_compilations.threads.clear();
+	}
+	for (thread& compilation : threads) {
+		compilation.join();
+	}
+}
+
+void InstallOptimizedModules(bool wait) {
+	if (!wait && finished_optimized_modules == 0) {
+		return;
+	}
+
+	vector<shared_ptr<OptimizedModule>> ready;
+	{
+		unique_lock<mutex> guard(optimized_modules_mutex);
+		if (wait) {
+			optimized_module_finished.wait(guard, [] { return finished_optimized_modules == (int)optimized_modules.size(); });
+		}
+		for (auto it = optimized_modules.begin(); it != optimized_modules.end();) {
+			if ((*it)->finished) {
+				ready.push_back(*it);
+				it = optimized_modules.erase(it);
+			} else {
+				++it;
+			}
+		}
+		finished_optimized_modules -= (int)ready.size();
+	}
+
+	for (auto& module : ready) {
+		Program* program = module->program;
+		if (module->error.empty()) {
+			auto load_start = std::chrono::high_resolution_clock::now();
+			try {
+				LoadKernelLibrary(program, module->library_name, module->kernel_libraries);
+			} catch (const std::exception& e) {
+				module->error = e.what();
+			}
+			auto load_end = std::chrono::high_resolution_clock::now();
+			program->host_compile_time = module->compile_time;
+			program->library_load_time = std::chrono::duration_cast<std::chrono::nanoseconds>(load_end - load_start).count() / 1000000.0f;
+		}
+		if (!module->error.empty()) {
+			cerr << "Optimized compilation of " << program->program_name << " failed, it stays interpreted: " << module->error << endl;
+		}
+	}
+}
+
+void DiscardOptimizedModule(Program* program) {
+	lock_guard<mutex> guard(optimized_modules_mutex);
+	for (auto it = optimized_modules.begin(); it != optimized_modules.end();) {
+		if ((*it)->program != program) {
+			++it;
+			continue;
+		}
+		if ((*it)->finished) {
+			finished_optimized_modules--;
+		}
+		(*it)->discarded = true;
+		it = optimized_modules.erase(it);
+	}
+}
+
+}  // namespace TensorFrost
\ No newline at end of file
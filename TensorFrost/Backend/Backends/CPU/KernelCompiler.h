@@ -31,7 +31,18 @@ namespace TensorFrost {
 using namespace std;
 
 extern std::string kernel_compile_options;
+extern bool tiered_compilation;
+extern std::string optimized_compile_options; // empty for -O3 -march=native
 
 void CompileAndLoadKernelModule(Program* program, size_t program_id);
 
+//compile the host program with optimized_compile_options on a background thread
+void CompileKernelModuleInBackground(Program* program, size_t program_id);
+//switch the programs whose background compilation finished to the compiled code, if wait is set wait for all of them
+void InstallOptimizedModules(bool wait);
+//the program is being deleted, its background compilation must not be installed
+void DiscardOptimizedModule(Program* program);
+//join the background compilation threads, called when the backend is stopped
+void WaitForBackgroundCompilations();
+
 }  // namespace TensorFrost
\ No newline at end of file
@@ -10,15 +10,27 @@
 #include <vector>
 
 #include "../../KernelManager.h"
+#include "../Interpreter/KernelManager.h"
 
 namespace TensorFrost {
 
 class CpuKernelManager : public KernelManager {
 	unordered_map<size_t, cpu_dispatch_func*> kernel_functions;
+	// kernels that run in the interpreter until their compiled version is loaded
+	InterpreterKernelManager interpreted_kernels;
  public:
 
 	void AddKernelFunction(Kernel* kernel, cpu_dispatch_func* func)	{ 
 		kernel_functions[kernel->kernel_id_] = func;
+		interpreted_kernels.RemoveKernel(kernel->kernel_id_);
+	}
+
+	void AddInterpretedKernel(Program* program, Kernel* kernel) {
+		interpreted_kernels.CompileKernel(program, kernel);
+	}
+
+	bool HasKernelFunction(size_t id) const {
+		return kernel_functions.contains(id);
 	}
 
 	cpu_dispatch_func* GetKernel(size_t id) {
@@ -27,14 +39,39 @@ class CpuKernelManager : public KernelManager {
 
 	void DispatchKernel(TFDispatchInfo info) override
 	{
-		cpu_dispatch_func* func = kernel_functions[info.kernel_id];
-		//get memory pointers
+		auto native = kernel_functions.find(info.kernel_id);
+		if (native == kernel_functions.end()) {
+			auto start = chrono::steady_clock::now();
+			interpreted_kernels.DispatchKernel(info);
+			if (profiling_enabled) {
+				auto end = chrono::steady_clock::now();
+				RecordDispatch(info.kernel_id, (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1000000.0, info.work_group_count);
+			}
+			return;
+		}
+
+		cpu_dispatch_func* func = native->second;
+		//get memory pointers and element counts
 		uint32_t** memory = new uint32_t*[info.read_write_count];
+		uint32_t* memory_size = new uint32_t[info.read_write_count];
 		for (size_t i = 0; i < info.read_write_count; i++) {
-			memory[i] = ((TFCPUBuffer*)info.read_write_tensors[i].buffer)->GetNative();
+			const TFTensor& tensor = info.read_write_tensors[i];
+			memory[i] = ((TFCPUBuffer*)tensor.buffer)->GetNative();
+			memory_size[i] = 1;
+			for (size_t d = 0; d < tensor.dim; d++) {
+				memory_size[i] *= (uint32_t)tensor.shape[d];
+			}
+		}
+		if (profiling_enabled) {
+			auto start = chrono::steady_clock::now();
+			func(info.variables, memory, memory_size, (uint)info.work_group_count);
+			auto end = chrono::steady_clock::now();
+			RecordDispatch(info.kernel_id, (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1000000.0, info.work_group_count);
+		} else {
+			func(info.variables, memory, memory_size, (uint)info.work_group_count);
 		}
-		func(info.variables, memory, (uint)info.work_group_count);
 		delete[] memory;
+		delete[] memory_size;
 	}
 };
 
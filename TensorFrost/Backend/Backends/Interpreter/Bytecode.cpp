@@ -0,0 +1,506 @@
+#include "Bytecode.h"
+
+namespace TensorFrost {
+
+const unordered_map<string, Opcode> value_opcodes = {
+	{"copy", Opcode::Copy}, {"asuint", Opcode::Copy}, {"asint", Opcode::Copy}, {"asfloat", Opcode::Copy},
+	{"asbool", Opcode::AsBool}, {"uint", Opcode::CastUint}, {"int", Opcode::CastInt}, {"float", Opcode::CastFloat},
+	{"bool", Opcode::CastBool},
+	{"add", Opcode::Add}, {"sub", Opcode::Sub}, {"mul", Opcode::Mul}, {"div", Opcode::Div}, {"mod", Opcode::Mod},
+	{"min", Opcode::Min}, {"max", Opcode::Max}, {"lshift", Opcode::LShift}, {"rshift", Opcode::RShift},
+	{"and", Opcode::And}, {"or", Opcode::Or}, {"xor", Opcode::Xor},
+	{"eq", Opcode::Eq}, {"neq", Opcode::Neq}, {"lt", Opcode::Lt}, {"lte", Opcode::Lte}, {"gt", Opcode::Gt}, {"gte", Opcode::Gte},
+	{"not", Opcode::Not}, {"neg", Opcode::Neg},
+	{"abs", Opcode::Abs}, {"sign", Opcode::Sign}, {"ceil", Opcode::Ceil}, {"floor", Opcode::Floor},
+	{"round", Opcode::Round}, {"frac", Opcode::Frac},
+	{"exp", Opcode::Exp}, {"exp2", Opcode::Exp2}, {"log", Opcode::Log}, {"log2", Opcode::Log2},
+	{"sqrt", Opcode::Sqrt}, {"rsqrt", Opcode::Rsqrt}, {"rcp", Opcode::Rcp},
+	{"sin", Opcode::Sin}, {"cos", Opcode::Cos}, {"tan", Opcode::Tan}, {"asin", Opcode::Asin}, {"acos", Opcode::Acos},
+	{"atan", Opcode::Atan}, {"sinh", Opcode::Sinh}, {"cosh", Opcode::Cosh}, {"tanh", Opcode::Tanh},
+	{"pcg", Opcode::Pcg}, {"pcgf", Opcode::Pcgf}, {"reversebits", Opcode::ReverseBits}, {"fastdiv", Opcode::FastDiv},
+	{"fastdiv_multiplier", Opcode::FastDivMultiplier}, {"fastdiv_shift", Opcode::FastDivShift},
+	{"pow", Opcode::Pow}, {"atan2", Opcode::Atan2}, {"modf", Opcode::Modf}, {"step", Opcode::Step},
+	{"clamp", Opcode::Clamp}, {"lerp", Opcode::Lerp}, {"fma", Opcode::Fma}, {"smoothstep", Opcode::SmoothStep},
+	{"ternary", Opcode::Ternary},
+};
+
+const unordered_map<string, Opcode> atomic_opcodes = {
+	{"InterlockedAdd", Opcode::AtomicAdd}, {"InterlockedMin", Opcode::AtomicMin}, {"InterlockedMax", Opcode::AtomicMax},
+	{"InterlockedAnd", Opcode::AtomicAnd}, {"InterlockedOr", Opcode::AtomicOr}, {"InterlockedXor", Opcode::AtomicXor},
+	{"InterlockedAdd_Prev", Opcode::AtomicAddPrev},
+};
+
+const unordered_map<string, Opcode> keyword_opcodes = {
+	{"break", Opcode::Break}, {"continue", Opcode::Continue}, {"discard", Opcode::Discard},
+};
+
+class BytecodeLowering {
+	Program* program;
+	Kernel* kernel; // nullptr for the host program
+	Node* root;
+	BytecodeFunction bytecode;
+
+	vector<Node*> order;
+	unordered_map<Node*, int> position;
+	unordered_map<Node*, int> body_end;
+	unordered_map<Node*, int> last_use;
+	unordered_map<Node*, uint32_t> registers;
+	unordered_map<uint32_t, uint32_t> constant_registers;
+	unordered_map<uint32_t, uint32_t> thread_id_registers;
+	//values computed before a loop that are read again right before their use inside of it
+	unordered_map<Node*, vector<Node*>> reloads;
+	unordered_map<Node*, unordered_map<Node*, bool>> reads_written_memory;
+
+	map<Node*, size_t> bindings;
+	unordered_map<Node*, uint32_t> tensors;
+	unordered_map<Node*, Kernel*> kernels;
+	unordered_map<Node*, int> input_indices;
+
+ public:
+	BytecodeLowering(Program* program, Kernel* kernel) : program(program), kernel(kernel) {
+		root = kernel ? kernel->root : program->ir_->root;
+		if (kernel) {
+			bindings = kernel->GetMemoryBindings();
+			bytecode.group_size = kernel->root->group_size;
+			for (int size : bytecode.group_size) {
+				bytecode.lanes *= (uint32_t)size;
+			}
+		} else {
+			for (Kernel& host_kernel : program->kernels_) {
+				kernels[host_kernel.root] = &host_kernel;
+			}
+			for (auto& [index, input] : program->ir_->input_memory_map) {
+				input_indices[input] = index;
+			}
+		}
+	}
+
+	BytecodeFunction Lower() {
+		Number(root, 0);
+		if (kernel) {
+			FindReloads();
+		}
+		AllocateFixedRegisters();
+		AllocateRegisters();
+		Emit(root);
+		if (!kernel) {
+			for (int i = 0; i < (int)program->ir_->output_memory_map.size(); i++) {
+				bytecode.outputs.push_back(TensorSlot(program->ir_->output_memory_map[i]));
+			}
+		}
+		return std::move(bytecode);
+	}
+
+ private:
+	static bool HasBody(const Node* node) {
+		return node->name == "loop" || node->name == "if";
+	}
+
+	void Number(Node* parent, uint32_t depth) {
+		for (Node* node = parent->child; node->valid(); node = node->next) {
+			position[node] = (int)order.size();
+			order.push_back(node);
+			if (HasBody(node)) {
+				uint32_t body_depth = depth + (node->name == "loop" ? 2 : 1);
+				bytecode.depth = max(bytecode.depth, body_depth);
+				Number(node, body_depth);
+				body_end[node] = (int)order.size();
+			}
+		}
+	}
+
+	//whether the value, computed outside of the loop, reads memory that is modified inside of it
+	bool ReadsMemoryWrittenIn(Node* node, Node* loop) {
+		auto& cache = reads_written_memory[loop];
+		if (cache.contains(node)) return cache[node];
+		bool reads = false;
+		if (node->name == "load") {
+			for (auto& [arg, user] : node->args.Get(ArgType::Memory)->args.outputs_) {
+				reads = reads || (user->op->HasAllTypes(OpProp::Modifier) && user->HasParent(loop));
+			}
+		} else if (value_opcodes.contains(node->name)) {
+			for (Node* operand : Operands(node)) {
+				reads = reads || (!IsFixed(operand) && ReadsMemoryWrittenIn(operand, loop));
+			}
+		}
+		return cache[node] = reads;
+	}
+
+	void AddReloads(Node* node, Node* loop, vector<Node*>& reload) {
+		if (find(reload.begin(), reload.end(), node) != reload.end()) return;
+		for (Node* operand : Operands(node)) {
+			if (!IsFixed(operand) && ReadsMemoryWrittenIn(operand, loop)) {
+				AddReloads(operand, loop, reload);
+			}
+		}
+		reload.push_back(node);
+	}
+
+	//the generated kernels read memory where the load is used, so a load before a loop that stores into the same memory sees every iteration
+	void FindReloads() {
+		for (Node* node : order) {
+			vector<Node*> reload;
+			for (Node* operand : Operands(node)) {
+				if (IsFixed(operand)) continue;
+				//the outermost loop around the user that the operand is not in
+				Node* outer_loop = nullptr;
+				for (Node* scope = node->parent; scope != nullptr && scope != root; scope = scope->parent) {
+					if (scope->name == "loop" && !operand->HasParent(scope)) {
+						outer_loop = scope;
+					}
+				}
+				if (outer_loop && ReadsMemoryWrittenIn(operand, outer_loop)) {
+					AddReloads(operand, outer_loop, reload);
+				}
+			}
+			if (!reload.empty()) {
+				reloads[node] = std::move(reload);
+			}
+		}
+	}
+
+	//nodes whose values are read from registers
+	vector<Node*> Operands(Node* node) {
+		vector<Node*> result;
+		if (!kernel && node->name == "kernel") {
+			Kernel* host_kernel = kernels.at(node);
+			for (auto& [variable, index] : host_kernel->variables) {
+				result.push_back(variable);
+			}
+			for (auto& [id, shape] : host_kernel->shape) {
+				result.push_back(shape);
+			}
+			return result;
+		}
+		ArgumentManager& args = node->args;
+		for (int i = 0; i < args.Count(ArgType::Input); i++) {
+			result.push_back(args.Get(ArgType::Input, i));
+		}
+		if (args.Has(ArgType::Index)) {
+			result.push_back(args.Get(ArgType::Index));
+		}
+		if (node->name == "set") {
+			result.push_back(args.Get(ArgType::Memory));
+		}
+		if (node->op->HasAllTypes(OpProp::Special, OpProp::HostOnly)) {
+			for (int i = 0; i < args.Count(ArgType::Shape); i++) {
+				result.push_back(args.Get(ArgType::Shape, i));
+			}
+		}
+		//memory is bound by slot, not read from a register
+		erase_if(result, [](Node* operand) { return operand->op->HasAllTypes(OpProp::Memory); });
+		return result;
+	}
+
+	//values that are filled before the execution and never overwritten
+	bool IsFixed(Node* node) const {
+		if (node->name == "const" && !node->flags.has(NodeProp::Modified)) return true;
+		if (node->name == "block_thread_id" || node->name == "block_id") return true;
+		return kernel && !node->HasParent(root);
+	}
+
+	bool ProducesValue(Node* node) const {
+		if (IsFixed(node) || node->op->HasAllTypes(OpProp::Memory)) return false;
+		if (node->op->HasAllTypes(OpProp::Scatter)) return node->type != TFType::None;
+		static const unordered_set<string> no_value = {
+			"store", "set", "if", "break", "continue", "discard", "region_begin", "region_end", "kernel",
+		};
+		return !no_value.contains(node->name);
+	}
+
+	uint32_t NewRegister() {
+		return bytecode.register_count++;
+	}
+
+	uint32_t ConstantRegister(uint32_t bits) {
+		if (!constant_registers.contains(bits)) {
+			constant_registers[bits] = NewRegister();
+			bytecode.constants.push_back({constant_registers[bits], bits});
+		}
+		return constant_registers[bits];
+	}
+
+	void AllocateFixedRegister(Node* node) {
+		if (registers.contains(node)) return;
+		if (kernel && !node->HasParent(root)) {
+			if (kernel->variables.contains(node)) {
+				registers[node] = NewRegister();
+				bytecode.variables.push_back({registers[node], (uint32_t)kernel->variables[node]});
+			} else if (node->name == "const") {
+				registers[node] = ConstantRegister(node->data[0]);
+			} else {
+				throw std::runtime_error("Kernel " + kernel->kernel_name_ + " reads " + node->var_name + " which is not passed as a variable");
+			}
+		} else if (node->name == "const") {
+			registers[node] = ConstantRegister(node->data[0]);
+		} else if (node->name == "block_thread_id") {
+			uint32_t dim = node->data[0];
+			if (!thread_id_registers.contains(dim)) {
+				thread_id_registers[dim] = NewRegister();
+				bytecode.thread_ids.push_back({thread_id_registers[dim], dim});
+			}
+			registers[node] = thread_id_registers[dim];
+		} else if (node->name == "block_id") {
+			if (bytecode.block_id == NO_REGISTER) {
+				bytecode.block_id = NewRegister();
+			}
+			registers[node] = bytecode.block_id;
+		}
+	}
+
+	void AllocateFixedRegisters() {
+		for (Node* node : order) {
+			for (Node* operand : Operands(node)) {
+				if (IsFixed(operand)) {
+					AllocateFixedRegister(operand);
+				}
+			}
+		}
+	}
+
+	//values defined outside of a loop must stay alive until the loop ends
+	int UsePosition(Node* user, Node* value) {
+		int use = position[user];
+		if (user->name == "loop") {
+			use = body_end[user];
+		}
+		for (Node* scope = user->parent; scope != nullptr && scope != root; scope = scope->parent) {
+			if (scope->name == "loop" && !value->HasParent(scope)) {
+				use = max(use, body_end[scope]);
+			}
+		}
+		return use;
+	}
+
+	//linear scan over the program order, registers of dead values are reused
+	void AllocateRegisters() {
+		for (Node* node : order) {
+			if (ProducesValue(node)) {
+				last_use[node] = node->name == "loop" ? body_end[node] : position[node];
+			}
+		}
+		for (Node* node : order) {
+			for (Node* operand : Operands(node)) {
+				if (IsFixed(operand)) continue;
+				if (!last_use.contains(operand)) {
+					throw std::runtime_error("Interpreter: " + node->name + " reads " + operand->name + " which has no value");
+				}
+				last_use[operand] = max(last_use[operand], UsePosition(node, operand));
+			}
+			if (!reloads.contains(node)) continue;
+			for (Node* value : reloads[node]) {
+				last_use[value] = max(last_use[value], UsePosition(node, value));
+				for (Node* operand : Operands(value)) {
+					if (!IsFixed(operand)) {
+						last_use[operand] = max(last_use[operand], UsePosition(node, operand));
+					}
+				}
+			}
+		}
+
+		vector<vector<Node*>> expiring(order.size() + 1);
+		for (auto& [node, use] : last_use) {
+			expiring[use].push_back(node);
+		}
+
+		vector<uint32_t> free_registers;
+		for (int p = 0; p < (int)order.size(); p++) {
+			for (Node* node : expiring[p]) {
+				if (position[node] < p) {
+					free_registers.push_back(registers[node]);
+				}
+			}
+			Node* node = order[p];
+			if (!ProducesValue(node)) continue;
+			if (free_registers.empty()) {
+				registers[node] = NewRegister();
+			} else {
+				registers[node] = free_registers.back();
+				free_registers.pop_back();
+			}
+			if (last_use[node] == p) {
+				free_registers.push_back(registers[node]);
+			}
+		}
+	}
+
+	uint32_t Register(Node* node) {
+		auto it = registers.find(node);
+		if (it == registers.end()) {
+			throw std::runtime_error("Interpreter: no register for " + node->name);
+		}
+		return it->second;
+	}
+
+	uint32_t TensorSlot(Node* node) {
+		auto it = tensors.find(node);
+		if (it == tensors.end()) {
+			throw std::runtime_error("Interpreter: " + node->var_name + " is used before it is allocated");
+		}
+		return it->second;
+	}
+
+	uint32_t AddCall(HostCall call) {
+		bytecode.calls.push_back(std::move(call));
+		return (uint32_t)bytecode.calls.size() - 1;
+	}
+
+	vector<uint32_t> ShapeRegisters(Node* node) {
+		vector<uint32_t> shape;
+		for (int i = 0; i < node->args.Count(ArgType::Shape); i++) {
+			shape.push_back(Register(node->args.Get(ArgType::Shape, i)));
+		}
+		return shape;
+	}
+
+	void Emit(Node* parent) {
+		for (Node* node = parent->child; node->valid(); node = node->next) {
+			if (reloads.contains(node)) {
+				for (Node* value : reloads[node]) {
+					EmitNode(value);
+				}
+			}
+			size_t index = bytecode.code.size();
+			EmitNode(node);
+			if (HasBody(node)) {
+				Emit(node);
+				bytecode.code[index].end = (uint32_t)bytecode.code.size();
+			}
+		}
+	}
+
+	void EmitNode(Node* node) {
+		if (IsFixed(node)) return;
+
+		ArgumentManager& args = node->args;
+		Instruction instruction = {};
+		instruction.type = args.Count(ArgType::Input) > 0 ? args.Type(ArgType::Input, 0) : node->type;
+		if (ProducesValue(node)) {
+			instruction.dst = Register(node);
+		}
+		for (int i = 0; i < args.Count(ArgType::Input) && i < 3; i++) {
+			instruction.src[i] = Register(args.Get(ArgType::Input, i));
+		}
+
+		const string& name = node->name;
+		if (value_opcodes.contains(name)) {
+			instruction.op = value_opcodes.at(name);
+		} else if (keyword_opcodes.contains(name)) {
+			instruction.op = keyword_opcodes.at(name);
+		} else if (name == "loop") {
+			instruction.op = Opcode::Loop;
+		} else if (name == "if") {
+			instruction.op = Opcode::If;
+		} else if (name == "const") {
+			instruction.op = Opcode::Fill;
+			instruction.data = node->data[0];
+		} else if (name == "set") {
+			instruction.op = Opcode::Set;
+			instruction.dst = Register(args.Get(ArgType::Memory));
+		} else if (node->op->HasAllTypes(OpProp::MemoryOp)) {
+			EmitMemoryOp(node, instruction);
+		} else if (!kernel) {
+			EmitHostOp(node, instruction);
+		} else {
+			throw std::runtime_error("Interpreter does not support " + name + " in kernels");
+		}
+		bytecode.code.push_back(instruction);
+	}
+
+	void EmitMemoryOp(Node* node, Instruction& instruction) {
+		ArgumentManager& args = node->args;
+		Node* memory = args.Get(ArgType::Memory);
+		instruction.src[0] = args.Has(ArgType::Index) ? Register(args.Get(ArgType::Index)) : NO_REGISTER;
+		instruction.src[1] = args.Count(ArgType::Input) > 0 ? Register(args.Get(ArgType::Input)) : NO_REGISTER;
+
+		if (!kernel) {
+			if (node->op->HasAllTypes(OpProp::Scatter)) {
+				throw std::runtime_error("Scatter operation not supported in non-kernel mode");
+			}
+			instruction.op = node->name == "load" ? Opcode::Read : Opcode::Write;
+			instruction.data = TensorSlot(memory);
+			return;
+		}
+
+		if (!bindings.contains(memory)) {
+			throw std::runtime_error("Kernel " + kernel->kernel_name_ + " accesses unbound memory " + memory->var_name);
+		}
+		instruction.data = (uint32_t)bindings[memory];
+		if (node->name == "load") {
+			instruction.op = Opcode::Load;
+		} else if (node->name == "store") {
+			instruction.op = Opcode::Store;
+		} else if (atomic_opcodes.contains(node->name)) {
+			instruction.op = atomic_opcodes.at(node->name);
+		} else {
+			throw std::runtime_error("Interpreter does not support " + node->name);
+		}
+	}
+
+	void EmitHostOp(Node* node, Instruction& instruction) {
+		const string& name = node->name;
+		HostCall call;
+		call.name = node->var_name;
+		call.type = node->type;
+		if (name == "memory") {
+			call.shape = ShapeRegisters(node);
+			call.tensor = tensors[node] = bytecode.tensor_count++;
+			if (node->flags.has(NodeProp::InputMemory)) {
+				instruction.op = Opcode::CheckInput;
+				call.source = input_indices.at(node);
+			} else {
+				instruction.op = Opcode::Allocate;
+			}
+		} else if (name == "reshape" || name == "assert") {
+			instruction.op = name == "reshape" ? Opcode::Reshape : Opcode::AssertTensor;
+			call.shape = ShapeRegisters(node);
+			call.source = TensorSlot(node->args.Get(ArgType::Memory));
+			call.tensor = tensors[node] = bytecode.tensor_count++;
+		} else if (name == "deallocate") {
+			instruction.op = Opcode::Deallocate;
+			call.source = TensorSlot(node->args.Get(ArgType::Memory));
+		} else if (name == "input_shape") {
+			instruction.op = Opcode::InputShape;
+			call.source = (uint32_t)node->flags.get(NodeProp::InputShapeMemory);
+			call.dim = (uint32_t)node->flags.get(NodeProp::InputShapeDim);
+		} else if (name == "region_begin" || name == "region_end") {
+			instruction.op = name == "region_begin" ? Opcode::RegionBegin : Opcode::RegionEnd;
+			call.name = node->debug_name;
+		} else if (name == "kernel") {
+			Kernel* host_kernel = kernels.at(node);
+			instruction.op = Opcode::Dispatch;
+			call.kernel_id = host_kernel->kernel_id_;
+			call.read_write.resize(host_kernel->read_write_memory.size());
+			for (auto& [memory, binding] : host_kernel->read_write_memory) {
+				call.read_write[binding] = TensorSlot(memory);
+			}
+			call.read_only.resize(host_kernel->read_only_memory.size());
+			for (auto& [memory, binding] : host_kernel->read_only_memory) {
+				call.read_only[binding] = TensorSlot(memory);
+			}
+			call.variables.resize(host_kernel->variables.size());
+			for (auto& [variable, index] : host_kernel->variables) {
+				call.variables[index] = Register(variable);
+			}
+			for (int d = 0; d < (int)host_kernel->shape.size(); d++) {
+				call.shape.push_back(Register(host_kernel->shape[ArgID(ArgType::Shape, d)]));
+			}
+			for (int size : host_kernel->root->group_size) {
+				call.group.push_back((size_t)size);
+			}
+		} else {
+			throw std::runtime_error("Interpreter does not support " + name + " in the host program");
+		}
+		instruction.data = AddCall(std::move(call));
+	}
+};
+
+BytecodeFunction LowerKernel(Program* program, Kernel* kernel) {
+	return BytecodeLowering(program, kernel).Lower();
+}
+
+BytecodeFunction LowerHost(Program* program) {
+	return BytecodeLowering(program, nullptr).Lower();
+}
+
+}  // namespace TensorFrost
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Backend/TensorMemory.h"
+#include "Compiler/KernelGen.h"
+
+namespace TensorFrost {
+
+using namespace std;
+
+enum class Opcode : uint8_t {
+	//control flow, the bodies follow the instruction and end at Instruction::end
+	If,
+	Loop,
+	Break,
+	Continue,
+	Discard,
+
+	//registers
+	Fill,
+	Copy,
+	Set,
+
+	//arithmetic, the typed variant is selected by Instruction::type
+	Add, Sub, Mul, Div, Mod, Min, Max,
+	LShift, RShift, And, Or, Xor,
+	Eq, Neq, Lt, Lte, Gt, Gte,
+	Not, Neg,
+	CastUint, CastInt, CastFloat, CastBool, AsBool,
+	Abs, Sign, Ceil, Floor, Round, Frac,
+	Exp, Exp2, Log, Log2, Sqrt, Rsqrt, Rcp,
+	Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh,
+	Pcg, Pcgf, ReverseBits, FastDiv, FastDivMultiplier, FastDivShift,
+	Pow, Atan2, Modf, Step, Clamp, Lerp, Fma, SmoothStep, Ternary,
+
+	//kernel memory
+	Load,
+	Store,
+	AtomicAdd, AtomicMin, AtomicMax, AtomicAnd, AtomicOr, AtomicXor, AtomicAddPrev,
+
+	//host operations
+	Allocate,
+	CheckInput,
+	Reshape,
+	AssertTensor,
+	Deallocate,
+	InputShape,
+	Dispatch,
+	Read,
+	Write,
+	RegionBegin,
+	RegionEnd,
+};
+
+#define NO_REGISTER 0xFFFFFFFFu
+
+struct Instruction {
+	Opcode op;
+	TFType type = TFType::None; // type of the first input
+	uint32_t dst = NO_REGISTER;
+	uint32_t src[3] = {NO_REGISTER, NO_REGISTER, NO_REGISTER};
+	uint32_t data = 0; // constant bits, memory binding, tensor slot or host call index
+	uint32_t end = 0; // index after the body of an if or a loop
+};
+
+//operands of the host operations that do not fit into an instruction
+struct HostCall {
+	string name;
+	TFType type = TFType::None;
+	vector<uint32_t> shape; // registers
+	uint32_t tensor = 0; // tensor slot of the result
+	uint32_t source = 0; // input index or tensor slot of the source
+	uint32_t dim = 0;
+	size_t kernel_id = 0;
+	vector<uint32_t> read_write; // tensor slots in binding order
+	vector<uint32_t> read_only;
+	vector<uint32_t> variables; // registers in kernel variable order
+	vector<size_t> group;
+};
+
+/// <summary>
+/// Register bytecode of a kernel or of the host program. Every register holds one value per lane,
+/// kernels run all the threads of a work group as lanes, the host program runs a single lane.
+/// </summary>
+struct BytecodeFunction {
+	vector<Instruction> code;
+	uint32_t register_count = 0;
+	uint32_t lanes = 1;
+	uint32_t depth = 0; // deepest nesting of the control flow, loops take two levels
+
+	//registers that are filled before the execution
+	vector<pair<uint32_t, uint32_t>> constants; // register, bits
+	vector<pair<uint32_t, uint32_t>> variables; // register, kernel variable index
+	vector<pair<uint32_t, uint32_t>> thread_ids; // register, block_thread_id dimension
+	uint32_t block_id = NO_REGISTER;
+	vector<int> group_size;
+
+	//host program
+	uint32_t tensor_count = 0;
+	vector<HostCall> calls;
+	vector<uint32_t> outputs; // tensor slots
+};
+
+BytecodeFunction LowerKernel(Program* program, Kernel* kernel);
+BytecodeFunction LowerHost(Program* program);
+
+}  // namespace TensorFrost
@@ -0,0 +1,570 @@
+#include "Executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace TensorFrost {
+
+struct HostState {
+	TFTensor* in;
+	TFRuntime runtime;
+	vector<TFTensor> tensors;
+};
+
+template <typename T> inline T FromBits(uint32_t x);
+template <> inline float FromBits<float>(uint32_t x) { return AsFloat(x); }
+template <> inline int FromBits<int>(uint32_t x) { return AsInt(x); }
+template <> inline uint32_t FromBits<uint32_t>(uint32_t x) { return x; }
+
+inline uint32_t ToBits(float x) { return AsUint(x); }
+inline uint32_t ToBits(int x) { return AsUint(x); }
+inline uint32_t ToBits(uint32_t x) { return x; }
+inline uint32_t ToBits(bool x) { return x ? 1u : 0u; }
+
+template <typename T, typename F>
+inline void Map(uint32_t* dst, const uint32_t* a, uint32_t lanes, F f) {
+	for (uint32_t l = 0; l < lanes; l++) {
+		dst[l] = ToBits(f(FromBits<T>(a[l])));
+	}
+}
+
+template <typename T, typename F>
+inline void Map(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t lanes, F f) {
+	for (uint32_t l = 0; l < lanes; l++) {
+		dst[l] = ToBits(f(FromBits<T>(a[l]), FromBits<T>(b[l])));
+	}
+}
+
+template <typename T, typename F>
+inline void Map(uint32_t* dst, const uint32_t* a, const uint32_t* b, const uint32_t* c, uint32_t lanes, F f) {
+	for (uint32_t l = 0; l < lanes; l++) {
+		dst[l] = ToBits(f(FromBits<T>(a[l]), FromBits<T>(b[l]), FromBits<T>(c[l])));
+	}
+}
+
+//inactive lanes execute the arithmetic too, so integer division must not trap
+inline float Divide(float a, float b) { return a / b; }
+inline int Divide(int a, int b) { return b == 0 ? 0 : (b == -1 ? (int)(0u - (uint32_t)a) : a / b); }
+inline uint32_t Divide(uint32_t a, uint32_t b) { return b == 0 ? 0 : a / b; }
+inline float Modulo(float a, float b) { return std::fmod(a, b); }
+inline int Modulo(int a, int b) { return (b == 0 || b == -1) ? 0 : a % b; }
+inline uint32_t Modulo(uint32_t a, uint32_t b) { return b == 0 ? 0 : a % b; }
+
+//same definitions as in the generated C++ code
+inline uint32_t Pcg(uint32_t v) {
+	uint32_t state = v * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+inline uint32_t ReverseBits(uint32_t x) {
+	x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
+	x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
+	x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
+	x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
+	return ((x >> 16) | (x << 16));
+}
+
+inline uint32_t FastDivShift(uint32_t d) {
+	uint32_t l = 0;
+	while (l < 32 && (uint64_t(1) << l) < d) l++;
+	return l;
+}
+
+inline uint32_t FastDivMultiplier(uint32_t d) {
+	uint64_t l = FastDivShift(d);
+	return (uint32_t)(((uint64_t(1) << 32) * ((uint64_t(1) << l) - d)) / d + 1);
+}
+
+inline uint32_t FastDiv(uint32_t n, uint32_t m, uint32_t l) {
+	uint32_t t = (uint32_t)(((uint64_t)n * m) >> 32);
+	return l == 0 ? n : (t + ((n - t) >> 1)) >> (l - 1);
+}
+
+template <typename T, typename F>
+inline uint32_t AtomicUpdate(uint32_t& place, uint32_t value, F op) {
+	std::atomic_ref<uint32_t> atomic(place);
+	uint32_t current = atomic.load(std::memory_order_relaxed);
+	while (!atomic.compare_exchange_weak(current, ToBits(op(FromBits<T>(current), FromBits<T>(value))), std::memory_order_relaxed)) {}
+	return current;
+}
+
+//selects the typed variant of an operation defined for floats, ints and uints
+#define TYPED_MAP(...) \
+	switch (instruction.type) { \
+		case TFType::Float: Map<float>(__VA_ARGS__); break; \
+		case TFType::Int: Map<int>(__VA_ARGS__); break; \
+		default: Map<uint32_t>(__VA_ARGS__); break; \
+	}
+
+BytecodeMachine::BytecodeMachine(const BytecodeFunction& function, const uint32_t* var, uint32_t** memory, const uint32_t* memory_size)
+    : function(function), lanes(function.lanes), memory(memory), memory_size(memory_size) {
+	registers.resize((size_t)function.register_count * lanes);
+	masks.resize((size_t)(function.depth + 1) * lanes);
+	for (auto& [reg, bits] : function.constants) {
+		std::fill_n(Reg(reg), lanes, bits);
+	}
+	for (auto& [reg, index] : function.variables) {
+		std::fill_n(Reg(reg), lanes, var[index]);
+	}
+	//same thread order as the loops of the generated C++ kernels, the first dimension is the innermost
+	int group_dim = (int)function.group_size.size();
+	for (auto& [reg, dim] : function.thread_ids) {
+		uint32_t stride = 1;
+		for (int d = group_dim - 1; d > group_dim - 1 - (int)dim; d--) {
+			stride *= (uint32_t)function.group_size[d];
+		}
+		uint32_t size = (uint32_t)function.group_size[group_dim - 1 - dim];
+		uint32_t* ids = Reg(reg);
+		for (uint32_t l = 0; l < lanes; l++) {
+			ids[l] = (l / stride) % size;
+		}
+	}
+}
+
+BytecodeMachine::BytecodeMachine(const BytecodeFunction& function, HostState* host)
+    : function(function), lanes(1), host(host) {
+	registers.resize(function.register_count);
+	masks.resize(function.depth + 1);
+	for (auto& [reg, bits] : function.constants) {
+		registers[reg] = bits;
+	}
+}
+
+void BytecodeMachine::RunBlock(size_t block_id) {
+	if (function.block_id != NO_REGISTER) {
+		std::fill_n(Reg(function.block_id), lanes, (uint32_t)block_id);
+	}
+	std::fill_n(Mask(0), lanes, (uint8_t)1);
+	Execute(0, function.code.size(), 0);
+}
+
+void BytecodeMachine::Run() {
+	RunBlock(0);
+}
+
+bool BytecodeMachine::Any(const uint8_t* mask) const {
+	for (uint32_t l = 0; l < lanes; l++) {
+		if (mask[l]) return true;
+	}
+	return false;
+}
+
+//break stops the lanes up to the innermost loop, continue only up to its body, discard stops them everywhere
+void BytecodeMachine::StopLanes(const uint8_t* lanes_to_stop, Opcode op) {
+	vector<uint8_t> stop(lanes_to_stop, lanes_to_stop + lanes);
+	for (int f = (int)frames.size() - 1; f >= 0; f--) {
+		Frame& frame = frames[f];
+		if (frame.loop && op == Opcode::Continue) break;
+		for (uint32_t l = 0; l < lanes; l++) {
+			if (stop[l]) frame.mask[l] = 0;
+		}
+		if (frame.loop && op == Opcode::Break) break;
+	}
+}
+
+void BytecodeMachine::Execute(size_t begin, size_t end, uint32_t depth) {
+	uint8_t* mask = Mask(depth);
+	frames.push_back({mask, false});
+	for (size_t i = begin; i < end; i++) {
+		const Instruction& instruction = function.code[i];
+		switch (instruction.op) {
+			case Opcode::If: {
+				uint8_t* body = Mask(depth + 1);
+				const uint32_t* condition = Reg(instruction.src[0]);
+				for (uint32_t l = 0; l < lanes; l++) {
+					body[l] = mask[l] & (condition[l] != 0);
+				}
+				if (Any(body)) {
+					Execute(i + 1, instruction.end, depth + 1);
+				}
+				i = instruction.end - 1;
+				break;
+			}
+			case Opcode::Loop:
+				ExecuteLoop(instruction, depth);
+				i = instruction.end - 1;
+				break;
+			case Opcode::Break:
+			case Opcode::Continue:
+			case Opcode::Discard:
+				StopLanes(mask, instruction.op);
+				break;
+			case Opcode::Fill:
+				std::fill_n(Reg(instruction.dst), lanes, instruction.data);
+				continue;
+			case Opcode::Set: {
+				uint32_t* dst = Reg(instruction.dst);
+				const uint32_t* src = Reg(instruction.src[0]);
+				for (uint32_t l = 0; l < lanes; l++) {
+					if (mask[l]) dst[l] = src[l];
+				}
+				continue;
+			}
+			default:
+				if (instruction.op < Opcode::Load) {
+					ExecuteArithmetic(instruction);
+				} else if (instruction.op <= Opcode::AtomicAddPrev) {
+					ExecuteMemory(instruction, mask);
+				} else {
+					ExecuteHost(instruction);
+				}
+				continue;
+		}
+		//all lanes could have been stopped by a break, continue or discard
+		if (!Any(mask)) break;
+	}
+	frames.pop_back();
+}
+
+void BytecodeMachine::ExecuteLoop(const Instruction& instruction, uint32_t depth) {
+	uint8_t* mask = Mask(depth);
+	uint8_t* looping = Mask(depth + 1);
+	uint8_t* body = Mask(depth + 2);
+	uint32_t* iterator = Reg(instruction.dst);
+	const uint32_t* begin = Reg(instruction.src[0]);
+	const uint32_t* end = Reg(instruction.src[1]);
+	const uint32_t* step = Reg(instruction.src[2]);
+	for (uint32_t l = 0; l < lanes; l++) {
+		if (mask[l]) iterator[l] = begin[l];
+		looping[l] = mask[l];
+	}
+	frames.push_back({looping, true});
+	while (true) {
+		bool any = false;
+		for (uint32_t l = 0; l < lanes; l++) {
+			looping[l] = looping[l] && AsInt(iterator[l]) < AsInt(end[l]);
+			body[l] = looping[l];
+			any |= looping[l] != 0;
+		}
+		if (!any) break;
+		Execute(&instruction - function.code.data() + 1, instruction.end, depth + 2);
+		for (uint32_t l = 0; l < lanes; l++) {
+			if (looping[l]) iterator[l] += step[l];
+		}
+	}
+	frames.pop_back();
+}
+
+void BytecodeMachine::ExecuteArithmetic(const Instruction& instruction) {
+	uint32_t* d = Reg(instruction.dst);
+	const uint32_t* a = instruction.src[0] != NO_REGISTER ? Reg(instruction.src[0]) : nullptr;
+	const uint32_t* b = instruction.src[1] != NO_REGISTER ? Reg(instruction.src[1]) : nullptr;
+	const uint32_t* c = instruction.src[2] != NO_REGISTER ? Reg(instruction.src[2]) : nullptr;
+	uint32_t n = lanes;
+	bool is_float = instruction.type == TFType::Float;
+
+	switch (instruction.op) {
+		case Opcode::Copy:
+			if (d != a) std::memcpy(d, a, n * sizeof(uint32_t));
+			break;
+		case Opcode::Add: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x + y; }) break;
+		case Opcode::Sub: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x - y; }) break;
+		case Opcode::Mul: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x * y; }) break;
+		case Opcode::Div: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return Divide(x, y); }) break;
+		case Opcode::Mod: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return Modulo(x, y); }) break;
+		case Opcode::Min: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x < y ? x : y; }) break;
+		case Opcode::Max: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x > y ? x : y; }) break;
+		case Opcode::LShift: Map<uint32_t>(d, a, b, n, [](uint32_t x, uint32_t y) { return x << (y & 31); }); break;
+		case Opcode::RShift:
+			if (instruction.type == TFType::Int) {
+				Map<int>(d, a, b, n, [](int x, int y) { return x >> (y & 31); });
+			} else {
+				Map<uint32_t>(d, a, b, n, [](uint32_t x, uint32_t y) { return x >> (y & 31); });
+			}
+			break;
+		case Opcode::And: Map<uint32_t>(d, a, b, n, [](uint32_t x, uint32_t y) { return x & y; }); break;
+		case Opcode::Or: Map<uint32_t>(d, a, b, n, [](uint32_t x, uint32_t y) { return x | y; }); break;
+		case Opcode::Xor: Map<uint32_t>(d, a, b, n, [](uint32_t x, uint32_t y) { return x ^ y; }); break;
+		case Opcode::Eq: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x == y; }) break;
+		case Opcode::Neq: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x != y; }) break;
+		case Opcode::Lt: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x < y; }) break;
+		case Opcode::Lte: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x <= y; }) break;
+		case Opcode::Gt: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x > y; }) break;
+		case Opcode::Gte: TYPED_MAP(d, a, b, n, [](auto x, auto y) { return x >= y; }) break;
+		case Opcode::Not: Map<uint32_t>(d, a, n, [](uint32_t x) { return x == 0; }); break;
+		case Opcode::Neg:
+			if (is_float) {
+				Map<float>(d, a, n, [](float x) { return -x; });
+			} else {
+				Map<uint32_t>(d, a, n, [](uint32_t x) { return 0u - x; });
+			}
+			break;
+		case Opcode::CastUint:
+			if (is_float) {
+				Map<float>(d, a, n, [](float x) { return (uint32_t)(int64_t)x; });
+			} else if (d != a) {
+				std::memcpy(d, a, n * sizeof(uint32_t));
+			}
+			break;
+		case Opcode::CastInt:
+			if (is_float) {
+				Map<float>(d, a, n, [](float x) { return (int)x; });
+			} else if (d != a) {
+				std::memcpy(d, a, n * sizeof(uint32_t));
+			}
+			break;
+		case Opcode::CastFloat:
+			switch (instruction.type) {
+				case TFType::Float: if (d != a) std::memcpy(d, a, n * sizeof(uint32_t)); break;
+				case TFType::Int: Map<int>(d, a, n, [](int x) { return (float)x; }); break;
+				case TFType::Bool: Map<uint32_t>(d, a, n, [](uint32_t x) { return x != 0 ? 1.0f : 0.0f; }); break;
+				default: Map<uint32_t>(d, a, n, [](uint32_t x) { return (float)x; }); break;
+			}
+			break;
+		case Opcode::CastBool:
+			if (is_float) {
+				Map<float>(d, a, n, [](float x) { return x != 0.0f; });
+			} else {
+				Map<uint32_t>(d, a, n, [](uint32_t x) { return x != 0; });
+			}
+			break;
+		case Opcode::AsBool: Map<uint32_t>(d, a, n, [](uint32_t x) { return x != 0; }); break;
+		case Opcode::Abs:
+			switch (instruction.type) {
+				case TFType::Float: Map<float>(d, a, n, [](float x) { return std::fabs(x); }); break;
+				case TFType::Int: Map<int>(d, a, n, [](int x) { return x < 0 ? 0u - (uint32_t)x : (uint32_t)x; }); break;
+				default: if (d != a) std::memcpy(d, a, n * sizeof(uint32_t)); break;
+			}
+			break;
+		case Opcode::Sign:
+			if (is_float) {
+				Map<float>(d, a, n, [](float x) { return x < 0.0f ? -1.0f : 1.0f; });
+			} else {
+				Map<int>(d, a, n, [](int x) { return x < 0 ? -1 : 1; });
+			}
+			break;
+		case Opcode::Ceil: Map<float>(d, a, n, [](float x) { return std::ceil(x); }); break;
+		case Opcode::Floor: Map<float>(d, a, n, [](float x) { return std::floor(x); }); break;
+		case Opcode::Round: Map<float>(d, a, n, [](float x) { return std::round(x); }); break;
+		case Opcode::Frac: Map<float>(d, a, n, [](float x) { return x - std::floor(x); }); break;
+		case Opcode::Exp: Map<float>(d, a, n, [](float x) { return std::exp(x); }); break;
+		case Opcode::Exp2: Map<float>(d, a, n, [](float x) { return std::exp2(x); }); break;
+		case Opcode::Log: Map<float>(d, a, n, [](float x) { return std::log(x); }); break;
+		case Opcode::Log2: Map<float>(d, a, n, [](float x) { return std::log2(x); }); break;
+		case Opcode::Sqrt: Map<float>(d, a, n, [](float x) { return std::sqrt(x); }); break;
+		case Opcode::Rsqrt: Map<float>(d, a, n, [](float x) { return 1.0f / std::sqrt(x); }); break;
+		case Opcode::Rcp: Map<float>(d, a, n, [](float x) { return 1.0f / x; }); break;
+		case Opcode::Sin: Map<float>(d, a, n, [](float x) { return std::sin(x); }); break;
+		case Opcode::Cos: Map<float>(d, a, n, [](float x) { return std::cos(x); }); break;
+		case Opcode::Tan: Map<float>(d, a, n, [](float x) { return std::tan(x); }); break;
+		case Opcode::Asin: Map<float>(d, a, n, [](float x) { return std::asin(x); }); break;
+		case Opcode::Acos: Map<float>(d, a, n, [](float x) { return std::acos(x); }); break;
+		case Opcode::Atan: Map<float>(d, a, n, [](float x) { return std::atan(x); }); break;
+		case Opcode::Sinh: Map<float>(d, a, n, [](float x) { return std::sinh(x); }); break;
+		case Opcode::Cosh: Map<float>(d, a, n, [](float x) { return std::cosh(x); }); break;
+		case Opcode::Tanh: Map<float>(d, a, n, [](float x) { return std::tanh(x); }); break;
+		case Opcode::Pcg: Map<uint32_t>(d, a, n, [](uint32_t x) { return Pcg(x); }); break;
+		case Opcode::Pcgf: Map<uint32_t>(d, a, n, [](uint32_t x) { return (float)Pcg(x) / (float)0xffffffffu; }); break;
+		case Opcode::ReverseBits: Map<uint32_t>(d, a, n, [](uint32_t x) { return ReverseBits(x); }); break;
+		case Opcode::FastDiv: Map<uint32_t>(d, a, b, c, n, [](uint32_t x, uint32_t m, uint32_t l) { return FastDiv(x, m, l); }); break;
+		case Opcode::FastDivMultiplier: Map<uint32_t>(d, a, n, [](uint32_t x) { return FastDivMultiplier(x); }); break;
+		case Opcode::FastDivShift: Map<uint32_t>(d, a, n, [](uint32_t x) { return FastDivShift(x); }); break;
+		case Opcode::Pow: Map<float>(d, a, b, n, [](float x, float y) { return std::pow(x, y); }); break;
+		case Opcode::Atan2: Map<float>(d, a, b, n, [](float x, float y) { return std::atan2(x, y); }); break;
+		case Opcode::Modf: Map<float>(d, a, b, n, [](float x, float y) { return x - y * std::floor(x / y); }); break;
+		case Opcode::Step: Map<float>(d, a, b, n, [](float edge, float x) { return x < edge ? 0.0f : 1.0f; }); break;
+		case Opcode::Clamp: TYPED_MAP(d, a, b, c, n, [](auto x, auto lo, auto hi) { x = x > lo ? x : lo; return x < hi ? x : hi; }) break;
+		case Opcode::Lerp: Map<float>(d, a, b, c, n, [](float x, float y, float t) { return x + (y - x) * t; }); break;
+		case Opcode::Fma: Map<float>(d, a, b, c, n, [](float x, float y, float z) { return std::fma(x, y, z); }); break;
+		case Opcode::SmoothStep:
+			Map<float>(d, a, b, c, n, [](float lo, float hi, float t) {
+				t = std::min(std::max((t - lo) / (hi - lo), 0.0f), 1.0f);
+				return t * t * (3.0f - 2.0f * t);
+			});
+			break;
+		case Opcode::Ternary: Map<uint32_t>(d, a, b, c, n, [](uint32_t x, uint32_t y, uint32_t z) { return x != 0 ? y : z; }); break;
+		default:
+			throw std::runtime_error("Interpreter: unknown arithmetic opcode " + to_string((int)instruction.op));
+	}
+}
+
+//out of bounds loads return 0 and out of bounds stores are skipped
+void BytecodeMachine::ExecuteMemory(const Instruction& instruction, const uint8_t* mask) {
+	uint32_t* memory_data = memory[instruction.data];
+	uint32_t size = memory_size[instruction.data];
+	const uint32_t* address = instruction.src[0] != NO_REGISTER ? Reg(instruction.src[0]) : nullptr;
+	const uint32_t* value = instruction.src[1] != NO_REGISTER ? Reg(instruction.src[1]) : nullptr;
+	uint32_t* dst = instruction.dst != NO_REGISTER ? Reg(instruction.dst) : nullptr;
+
+	for (uint32_t l = 0; l < lanes; l++) {
+		if (!mask[l]) continue;
+		uint32_t a = address ? address[l] : 0;
+		if (instruction.op == Opcode::Load) {
+			dst[l] = a < size ? memory_data[a] : 0;
+			continue;
+		}
+		if (a >= size) continue;
+		uint32_t& place = memory_data[a];
+		uint32_t previous = 0;
+		switch (instruction.op) {
+			case Opcode::Store:
+				place = value[l];
+				break;
+			case Opcode::AtomicAdd:
+			case Opcode::AtomicAddPrev:
+				if (instruction.type == TFType::Float) {
+					previous = AtomicUpdate<float>(place, value[l], [](float x, float y) { return x + y; });
+				} else {
+					previous = std::atomic_ref<uint32_t>(place).fetch_add(value[l], std::memory_order_relaxed);
+				}
+				break;
+			case Opcode::AtomicMin:
+				switch (instruction.type) {
+					case TFType::Float: AtomicUpdate<float>(place, value[l], [](float x, float y) { return std::min(x, y); }); break;
+					case TFType::Int: AtomicUpdate<int>(place, value[l], [](int x, int y) { return std::min(x, y); }); break;
+					default: AtomicUpdate<uint32_t>(place, value[l], [](uint32_t x, uint32_t y) { return std::min(x, y); }); break;
+				}
+				break;
+			case Opcode::AtomicMax:
+				switch (instruction.type) {
+					case TFType::Float: AtomicUpdate<float>(place, value[l], [](float x, float y) { return std::max(x, y); }); break;
+					case TFType::Int: AtomicUpdate<int>(place, value[l], [](int x, int y) { return std::max(x, y); }); break;
+					default: AtomicUpdate<uint32_t>(place, value[l], [](uint32_t x, uint32_t y) { return std::max(x, y); }); break;
+				}
+				break;
+			case Opcode::AtomicAnd:
+				std::atomic_ref<uint32_t>(place).fetch_and(value[l], std::memory_order_relaxed);
+				break;
+			case Opcode::AtomicOr:
+				std::atomic_ref<uint32_t>(place).fetch_or(value[l], std::memory_order_relaxed);
+				break;
+			case Opcode::AtomicXor:
+				std::atomic_ref<uint32_t>(place).fetch_xor(value[l], std::memory_order_relaxed);
+				break;
+			default:
+				break;
+		}
+		if (dst) dst[l] = previous;
+	}
+}
+
+const unordered_map<TFType, string> host_type_names = {
+	{TFType::Float, "Float"}, {TFType::Uint, "Uint"}, {TFType::Int, "Int"}, {TFType::Bool, "Bool"}, {TFType::None, "None"},
+};
+
+//same checks as TFContext::check_tensor in the generated host code
+void CheckTensor(const TFTensor& tensor, const HostCall& call, const vector<size_t>& shape) {
+	if (tensor.type != call.type) {
+		throw std::runtime_error("Invalid type for " + call.name + ". Expected " + host_type_names.at(call.type) + ", got " + host_type_names.at(tensor.type));
+	}
+	if (tensor.dim != shape.size()) {
+		throw std::runtime_error("Invalid number of dimensions for " + call.name + ". Expected " + to_string(shape.size()) + ", got " + to_string(tensor.dim));
+	}
+	for (size_t i = 0; i < tensor.dim; i++) {
+		if (tensor.shape[i] != shape[i] || shape[i] < 1) {
+			throw std::runtime_error("Invalid shape for dimension " + to_string(i) + " in " + call.name + ". Expected " + to_string(shape[i]) + ", got " + to_string(tensor.shape[i]));
+		}
+	}
+}
+
+void BytecodeMachine::ExecuteHost(const Instruction& instruction) {
+	TFRuntime& runtime = host->runtime;
+	vector<TFTensor>& tensors = host->tensors;
+	if (instruction.op == Opcode::Read || instruction.op == Opcode::Write) {
+		size_t address = instruction.src[0] != NO_REGISTER ? (size_t)AsInt(registers[instruction.src[0]]) : 0;
+		if (instruction.op == Opcode::Read) {
+			registers[instruction.dst] = runtime.readback(tensors[instruction.data], address, runtime.custom_data);
+		} else {
+			runtime.writeback(tensors[instruction.data], address, registers[instruction.src[1]], runtime.custom_data);
+		}
+		return;
+	}
+
+	const HostCall& call = function.calls[instruction.data];
+	vector<size_t> shape;
+	for (uint32_t reg : call.shape) {
+		shape.push_back((size_t)registers[reg]);
+	}
+
+	switch (instruction.op) {
+		case Opcode::Allocate:
+			for (size_t i = 0; i < shape.size(); i++) {
+				if (shape[i] < 1) {
+					throw std::runtime_error("Invalid shape on dimension " + to_string(i) + " for " + call.name + ". Expected positive integer, got " + to_string(shape[i]));
+				}
+			}
+			tensors[call.tensor] = runtime.alloc(call.name.c_str(), shape.data(), shape.size(), call.type, runtime.custom_data);
+			break;
+		case Opcode::CheckInput:
+			CheckTensor(host->in[call.source], call, shape);
+			tensors[call.tensor] = host->in[call.source];
+			break;
+		case Opcode::Reshape: {
+			const TFTensor& source = tensors[call.source];
+			size_t old_size = GetSize(&source);
+			size_t new_size = GetLinearSize(shape);
+			if (old_size != new_size) {
+				throw std::runtime_error("Cannot reshape " + call.name + ", expected " + to_string(new_size) + " elements, while input has " + to_string(old_size));
+			}
+			//the shape is owned by the returned tensor, like in TFContext::reshape
+			size_t* new_shape = new size_t[shape.size()];
+			std::copy(shape.begin(), shape.end(), new_shape);
+			tensors[call.tensor] = {source.buffer, call.type, shape.size(), new_shape};
+			break;
+		}
+		case Opcode::AssertTensor:
+			CheckTensor(tensors[call.source], call, shape);
+			tensors[call.tensor] = tensors[call.source];
+			break;
+		case Opcode::Deallocate:
+			runtime.dealloc(tensors[call.source], runtime.custom_data);
+			break;
+		case Opcode::InputShape:
+			registers[instruction.dst] = (uint32_t)host->in[call.source].shape[call.dim];
+			break;
+		case Opcode::Dispatch: {
+			vector<TFTensor> all_tensors;
+			for (uint32_t slot : call.read_write) {
+				all_tensors.push_back(tensors[slot]);
+				tensors[slot].buffer->up_to_date = false;
+			}
+			for (uint32_t slot : call.read_only) {
+				all_tensors.push_back(tensors[slot]);
+			}
+			vector<uint32_t> variables;
+			for (uint32_t reg : call.variables) {
+				variables.push_back(registers[reg]);
+			}
+			//only the last dimensions are divided by the group size
+			size_t work_group_count = 1;
+			size_t group_start = shape.size() - call.group.size();
+			for (size_t i = 0; i < shape.size(); i++) {
+				work_group_count *= i < group_start ? shape[i] : (shape[i] + call.group[i - group_start] - 1) / call.group[i - group_start];
+			}
+			TFDispatchInfo info = {call.kernel_id, all_tensors.size(), all_tensors.data(), 0, nullptr,
+			                       variables.size(), variables.data(), work_group_count};
+			runtime.dispatch(info, runtime.custom_data);
+			break;
+		}
+		case Opcode::RegionBegin:
+		case Opcode::RegionEnd:
+			if (runtime.region != nullptr) {
+				runtime.region(call.name.c_str(), instruction.op == Opcode::RegionBegin, runtime.custom_data);
+			}
+			break;
+		default:
+			throw std::runtime_error("Interpreter: unknown host opcode " + to_string((int)instruction.op));
+	}
+}
+
+void LoadInterpretedProgram(Program* program) {
+	auto start = std::chrono::high_resolution_clock::now();
+	shared_ptr<BytecodeFunction> host = make_shared<BytecodeFunction>(LowerHost(program));
+	program->execute_callback = [host](TFTensor* in, TFTensor* out, TFRuntime runtime) {
+		HostState state = {in, runtime, vector<TFTensor>(host->tensor_count)};
+		BytecodeMachine machine(*host, &state);
+		machine.Run();
+		for (size_t i = 0; i < host->outputs.size(); i++) {
+			out[i] = state.tensors[host->outputs[i]];
+		}
+	};
+	auto end = std::chrono::high_resolution_clock::now();
+	program->host_compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0f;
+	program->library_load_time = 0.0f;
+}
+
+}  // namespace TensorFrost
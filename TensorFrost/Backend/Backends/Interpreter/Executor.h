@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "Bytecode.h"
+
+namespace TensorFrost {
+
+using namespace std;
+
+struct HostState;
+
+/// <summary>
+/// Executes bytecode on all lanes at once, control flow is handled with per lane masks
+/// </summary>
+class BytecodeMachine {
+	struct Frame {
+		uint8_t* mask;
+		bool loop; // lanes that keep iterating a loop, break stops here
+	};
+
+	const BytecodeFunction& function;
+	uint32_t lanes;
+	vector<uint32_t> registers;
+	vector<uint8_t> masks;
+	vector<Frame> frames;
+
+	//kernel memory
+	uint32_t** memory = nullptr;
+	const uint32_t* memory_size = nullptr;
+
+	HostState* host = nullptr;
+
+	uint32_t* Reg(uint32_t index) { return registers.data() + (size_t)index * lanes; }
+	uint8_t* Mask(uint32_t depth) { return masks.data() + (size_t)depth * lanes; }
+	bool Any(const uint8_t* mask) const;
+	void StopLanes(const uint8_t* lanes_to_stop, Opcode op);
+
+	void Execute(size_t begin, size_t end, uint32_t depth);
+	void ExecuteLoop(const Instruction& instruction, uint32_t depth);
+	void ExecuteArithmetic(const Instruction& instruction);
+	void ExecuteMemory(const Instruction& instruction, const uint8_t* mask);
+	void ExecuteHost(const Instruction& instruction);
+
+ public:
+	BytecodeMachine(const BytecodeFunction& function, const uint32_t* var, uint32_t** memory, const uint32_t* memory_size);
+	BytecodeMachine(const BytecodeFunction& function, HostState* host);
+
+	void RunBlock(size_t block_id);
+	void Run();
+};
+
+//set the execute callback of the program to interpret its host code
+void LoadInterpretedProgram(Program* program);
+
+}  // namespace TensorFrost
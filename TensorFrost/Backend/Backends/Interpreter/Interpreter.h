@@ -0,0 +1,5 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Executor.h"
+#include "KernelManager.h"
\ No newline at end of file
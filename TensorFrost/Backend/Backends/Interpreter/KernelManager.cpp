@@ -0,0 +1,109 @@
+#include "KernelManager.h"
+
+#include <atomic>
+#include <chrono>
+
+#include "Backend/Backends/CPU/Memory.h"
+#include "Executor.h"
+
+namespace TensorFrost {
+
+#define INTERPRETER_MIN_PARALLEL_WORK 65536 // lane instructions, smaller dispatches run on the calling thread
+#define INTERPRETER_CHUNKS_PER_WORKER 8
+
+InterpreterThreadPool::InterpreterThreadPool(int thread_count) {
+	for (int i = 1; i < thread_count; i++) {
+		workers.emplace_back(&InterpreterThreadPool::WorkerLoop, this, i);
+	}
+}
+
+InterpreterThreadPool::~InterpreterThreadPool() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void InterpreterThreadPool::WorkerLoop(int worker_id) {
+	size_t seen_generation = 0;
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [&] { return stopping || generation != seen_generation; });
+		if (stopping) return;
+		seen_generation = generation;
+		guard.unlock();
+		task(worker_id);
+		guard.lock();
+		if (--running == 0) {
+			finished.notify_all();
+		}
+	}
+}
+
+void InterpreterThreadPool::Run(const function<void(int)>& new_task) {
+	{
+		lock_guard<mutex> guard(lock);
+		task = new_task;
+		running = (int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	new_task(0);
+	unique_lock<mutex> guard(lock);
+	finished.wait(guard, [&] { return running == 0; });
+}
+
+void InterpreterKernelManager::CompileKernel(Program* program, Kernel* kernel) {
+	kernel_functions[kernel->kernel_id_] = make_shared<BytecodeFunction>(LowerKernel(program, kernel));
+}
+
+void InterpreterKernelManager::DispatchKernel(TFDispatchInfo info) {
+	const BytecodeFunction& function = *kernel_functions.at(info.kernel_id);
+
+	//get memory pointers and element counts
+	vector<uint32_t*> memory(info.read_write_count);
+	vector<uint32_t> memory_size(info.read_write_count);
+	for (size_t i = 0; i < info.read_write_count; i++) {
+		const TFTensor& tensor = info.read_write_tensors[i];
+		memory[i] = ((TFCPUBuffer*)tensor.buffer)->GetNative();
+		memory_size[i] = (uint32_t)GetSize(&tensor);
+	}
+
+	auto start = chrono::steady_clock::now();
+	size_t blocks = info.work_group_count;
+	size_t work = blocks * function.lanes * function.code.size();
+	if (blocks <= 1 || work < INTERPRETER_MIN_PARALLEL_WORK) {
+		BytecodeMachine machine(function, info.variables, memory.data(), memory_size.data());
+		for (size_t block = 0; block < blocks; block++) {
+			machine.RunBlock(block);
+		}
+	} else {
+		if (!thread_pool) {
+			thread_pool = make_unique<InterpreterThreadPool>(max(1, (int)thread::hardware_concurrency()));
+		}
+		//the workers take chunks of blocks until all of them are done
+		size_t chunk = max<size_t>(1, blocks / ((size_t)thread_pool->Size() * INTERPRETER_CHUNKS_PER_WORKER));
+		atomic<size_t> next_block = 0;
+		thread_pool->Run([&](int) {
+			BytecodeMachine machine(function, info.variables, memory.data(), memory_size.data());
+			while (true) {
+				size_t first = next_block.fetch_add(chunk);
+				if (first >= blocks) break;
+				size_t last = min(blocks, first + chunk);
+				for (size_t block = first; block < last; block++) {
+					machine.RunBlock(block);
+				}
+			}
+		});
+	}
+	if (profiling_enabled) {
+		auto end = chrono::steady_clock::now();
+		RecordDispatch(info.kernel_id, (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1000000.0, info.work_group_count);
+	}
+}
+
+}  // namespace TensorFrost
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../../KernelManager.h"
+#include "Bytecode.h"
+
+namespace TensorFrost {
+
+using namespace std;
+
+/// <summary>
+/// Persistent worker threads, so that dispatches do not pay for creating threads
+/// </summary>
+class InterpreterThreadPool {
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable finished;
+	function<void(int)> task;
+	size_t generation = 0;
+	int running = 0;
+	bool stopping = false;
+
+	void WorkerLoop(int worker_id);
+ public:
+	explicit InterpreterThreadPool(int thread_count);
+	~InterpreterThreadPool();
+
+	int Size() const { return (int)workers.size() + 1; }
+
+	//run the task on every worker and on the calling thread, returns when all of them are done
+	void Run(const function<void(int)>& new_task);
+};
+
+class InterpreterKernelManager : public KernelManager {
+	unordered_map<size_t, shared_ptr<BytecodeFunction>> kernel_functions;
+	unique_ptr<InterpreterThreadPool> thread_pool;
+ public:
+	void CompileKernel(Program* program, Kernel* kernel);
+	void RemoveKernel(size_t kernel_id) { kernel_functions.erase(kernel_id); }
+	void DispatchKernel(TFDispatchInfo info) override;
+};
+
+}  // namespace TensorFrost
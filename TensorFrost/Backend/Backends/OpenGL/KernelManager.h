@@ -17,9 +17,11 @@ class OpenGLKernelManager : public KernelManager {
 	unordered_map<size_t, GLuint> kernel_map;
 	const int WORK_GROUP_SIZE = 256;
 	GLuint ubo;
+	GLuint timer_query;
  public:
 	OpenGLKernelManager() {
         glGenBuffers(1, &ubo);
+		glGenQueries(1, &timer_query);
 		//allocate sizeof(uint32_t) * 32 bytes
 		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
 		glBufferData(GL_UNIFORM_BUFFER, sizeof(uint32_t) * 32, nullptr, GL_DYNAMIC_DRAW);
@@ -132,12 +134,24 @@ class OpenGLKernelManager : public KernelManager {
 		// Bind the UBO
 		glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
 
+		if (profiling_enabled) {
+			glBeginQuery(GL_TIME_ELAPSED, timer_query);
+		}
+
 		// Dispatch the kernel
 		glDispatchCompute((GLuint)info.work_group_count, 1, 1);
 
 		// Wait for the kernel to finish
 		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
+		if (profiling_enabled) {
+			glEndQuery(GL_TIME_ELAPSED);
+			// blocks until the kernel is done, only done when profiling
+			GLuint64 elapsed_ns = 0;
+			glGetQueryObjectui64v(timer_query, GL_QUERY_RESULT, &elapsed_ns);
+			RecordDispatch(info.kernel_id, (double)elapsed_ns / 1000000.0, info.work_group_count);
+		}
+
 		// Unbind the memory buffer
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
 
@@ -170,6 +184,7 @@ class OpenGLKernelManager : public KernelManager {
 	{
 		FreeAllKernels();
 		glDeleteBuffers(1, &ubo);
+		glDeleteQueries(1, &timer_query);
 	}
 };
 
@@ -103,7 +103,19 @@ protected:
 				bool has_single_output = (node->args.outputs_.size() == 1) || is_constant || is_variable;
 				bool modified = node->flags.has(NodeProp::Modified);
 				bool short_enough = expr.size() < 100;
-				bool can_substitude = !has_name && has_single_output && !modified && short_enough && !is_static && !is_memory;
+				//dont put loop invariant expressions back into the loop, unless they read memory the loop writes
+				bool moves_into_loop = false;
+				if (!is_constant && node->args.outputs_.size() == 1 && !node->op->HasAllTypes(OpProp::Load)) {
+					//the outermost loop around the user that the node is not in
+					Node* outer_loop = nullptr;
+					for (Node* parent = node->args.outputs_[0].second->parent; parent != nullptr; parent = parent->parent) {
+						if (parent->name == "loop" && !node->HasParent(parent)) {
+							outer_loop = parent;
+						}
+					}
+					moves_into_loop = outer_loop != nullptr && !ReadsMemoryWrittenIn(node, outer_loop);
+				}
+				bool can_substitude = !has_name && has_single_output && !modified && short_enough && !is_static && !is_memory && !moves_into_loop;
 				if (can_substitude) {
 					if (expr == "") {
 						throw std::runtime_error("Substitute expression is empty");
@@ -117,6 +129,24 @@ protected:
 		}
 	}
 
+	//whether the expression of the node, with its substituted inputs, reads memory that is modified inside the loop
+	bool ReadsMemoryWrittenIn(Node* node, Node* loop) {
+		if (node->op->HasAllTypes(OpProp::Load)) {
+			Node* memory = node->args.Get(ArgType::Memory);
+			for (auto& [arg, user] : memory->args.outputs_) {
+				if (user->op->HasAllTypes(OpProp::Modifier) && user->HasParent(loop)) {
+					return true;
+				}
+			}
+		}
+		for (auto& [id, input] : node->args.inputs_) {
+			if (lines_to_remove.contains(input) && ReadsMemoryWrittenIn(input, loop)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void RegenerateNodeName(Node* node) {
 		string debug = node->debug_name;
 		if (debug.empty()) {
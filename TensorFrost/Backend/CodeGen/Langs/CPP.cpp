@@ -13,6 +13,8 @@ string GetCPPHeader() {
 #include <functional>
 #include <vector>
 #include <atomic>
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <tuple>
@@ -20,6 +22,29 @@ string GetCPPHeader() {
 
 typedef uint32_t uint;
 
+//the global math functions of the C library take and return double, use the float overloads instead
+using std::abs;
+using std::ceil;
+using std::floor;
+using std::round;
+using std::exp;
+using std::exp2;
+using std::log;
+using std::log2;
+using std::sqrt;
+using std::sin;
+using std::cos;
+using std::tan;
+using std::asin;
+using std::acos;
+using std::atan;
+using std::sinh;
+using std::cosh;
+using std::tanh;
+using std::pow;
+using std::atan2;
+using std::fma;
+
 inline int min(int a, int b)
 {
 	return a < b ? a : b;
@@ -115,125 +140,177 @@ inline uint reversebits(uint x)
 	return ((x >> 16) | (x << 16));
 }
 
-inline void InterlockedAdd(int* memory, int address, int value)
+inline uint fastdiv_shift(uint d)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	place->fetch_add(value, std::memory_order_relaxed);
+	uint l = 0;
+	while (l < 32 && (uint64_t(1) << l) < d) l++;
+	return l;
 }
 
-inline void InterlockedAdd(uint* memory, int address, uint value)
+inline uint fastdiv_multiplier(uint d)
 {
-	std::atomic<uint>* place = reinterpret_cast<std::atomic<uint>*>(&memory[address]);
-	place->fetch_add(value, std::memory_order_relaxed);
+	uint64_t l = fastdiv_shift(d);
+	return (uint)(((uint64_t(1) << 32) * ((uint64_t(1) << l) - d)) / d + 1);
 }
 
-inline void InterlockedAdd(float* memory, int address, float value)
+inline uint fastdiv(uint n, uint m, uint l)
+{
+	uint t = (uint)(((uint64_t)n * m) >> 32);
+	return l == 0 ? n : (t + ((n - t) >> 1)) >> (l - 1);
+}
+
+//use atomic_ref where available, otherwise reinterpret the memory as atomics
+#if defined(__cpp_lib_atomic_ref)
+template <typename T>
+inline std::atomic_ref<T> atomic_at(T* memory, int address)
+{
+	return std::atomic_ref<T>(memory[address]);
+}
+#else
+template <typename T>
+inline std::atomic<T>& atomic_at(T* memory, int address)
 {
-	std::atomic<float>* place = reinterpret_cast<std::atomic<float>*>(&memory[address]);
-	float current = place->load(std::memory_order_relaxed);
-	float goal = current + value;
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = current + value;
+	return *reinterpret_cast<std::atomic<T>*>(&memory[address]);
+}
+#endif
+
+template <typename T, typename F>
+inline T atomic_update(T* memory, int address, T value, F op)
+{
+	auto&& place = atomic_at(memory, address);
+	T current = place.load(std::memory_order_relaxed);
+	T goal = op(current, value);
+	while (!place.compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
+		goal = op(current, value);
 	}
+	return current;
 }
 
-inline int InterlockedAdd_Prev(int* memory, int address, int value)
+inline void InterlockedAdd(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	return place->fetch_add(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_add(value, std::memory_order_relaxed);
 }
 
-inline uint InterlockedAdd_Prev(uint* memory, int address, uint value)
+inline void InterlockedAdd(uint* memory, int address, uint value)
 {
-	std::atomic<uint>* place = reinterpret_cast<std::atomic<uint>*>(&memory[address]);
-	return place->fetch_add(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_add(value, std::memory_order_relaxed);
 }
 
 inline float InterlockedAdd_Prev(float* memory, int address, float value)
 {
-	std::atomic<float>* place = reinterpret_cast<std::atomic<float>*>(&memory[address]);
-	float current = place->load(std::memory_order_relaxed);
-	float goal = current + value;
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = current + value;
-	}
-	return current;
+#if defined(__cpp_lib_atomic_ref) && defined(__cpp_lib_atomic_float)
+	return atomic_at(memory, address).fetch_add(value, std::memory_order_relaxed);
+#else
+	return atomic_update(memory, address, value, [](float a, float b) { return a + b; });
+#endif
+}
+
+inline void InterlockedAdd(float* memory, int address, float value)
+{
+	InterlockedAdd_Prev(memory, address, value);
+}
+
+inline int InterlockedAdd_Prev(int* memory, int address, int value)
+{
+	return atomic_at(memory, address).fetch_add(value, std::memory_order_relaxed);
+}
+
+inline uint InterlockedAdd_Prev(uint* memory, int address, uint value)
+{
+	return atomic_at(memory, address).fetch_add(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedAnd(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	place->fetch_or(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_and(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedAnd(uint* memory, int address, uint value)
 {
-	std::atomic<uint>* place = reinterpret_cast<std::atomic<uint>*>(&memory[address]);
-	place->fetch_and(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_and(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedOr(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	place->fetch_or(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_or(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedOr(uint* memory, int address, uint value)
 {
-	std::atomic<uint>* place = reinterpret_cast<std::atomic<uint>*>(&memory[address]);
-	place->fetch_or(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_or(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedXor(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	place->fetch_xor(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_xor(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedXor(uint* memory, int address, uint value)
 {
-	std::atomic<uint>* place = reinterpret_cast<std::atomic<uint>*>(&memory[address]);
-	place->fetch_xor(value, std::memory_order_relaxed);
+	atomic_at(memory, address).fetch_xor(value, std::memory_order_relaxed);
 }
 
 inline void InterlockedMin(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	int current = place->load(std::memory_order_relaxed);
-	int goal = min(current, value);
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = min(current, value);
-	}
+	atomic_update(memory, address, value, [](int a, int b) { return min(a, b); });
 }
 
 inline void InterlockedMin(float* memory, int address, float value)
 {
-	std::atomic<float>* place = reinterpret_cast<std::atomic<float>*>(&memory[address]);
-	float current = place->load(std::memory_order_relaxed);
-	float goal = min(current, value);
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = min(current, value);
-	}
+	atomic_update(memory, address, value, [](float a, float b) { return min(a, b); });
 }
 
 inline void InterlockedMax(int* memory, int address, int value)
 {
-	std::atomic<int>* place = reinterpret_cast<std::atomic<int>*>(&memory[address]);
-	int current = place->load(std::memory_order_relaxed);
-	int goal = max(current, value);
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = max(current, value);
-	}
+	atomic_update(memory, address, value, [](int a, int b) { return max(a, b); });
 }
 
 inline void InterlockedMax(float* memory, int address, float value)
 {
-	std::atomic<float>* place = reinterpret_cast<std::atomic<float>*>(&memory[address]);
-	float current = place->load(std::memory_order_relaxed);
-	float goal = max(current, value);
-	while (!place->compare_exchange_weak(current, goal, std::memory_order_release, std::memory_order_relaxed)) {
-		goal = max(current, value);
-	}
+	atomic_update(memory, address, value, [](float a, float b) { return max(a, b); });
+}
+
+inline int worker_count()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+//the number of workers that actually run the current parallel region, can be less than worker_count()
+inline int team_size()
+{
+#ifdef _OPENMP
+	return omp_get_num_threads();
+#else
+	return 1;
+#endif
+}
+
+inline int worker_id()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+#define MAX_PRIVATE_SCATTER_SIZE 1048576
+
+//scatter into per worker copies if the memory is small compared to the dispatch, so that the workers do not contend on the same addresses
+inline bool privatize_scatter(size_t memory_size, int workers, size_t dispatch_size)
+{
+	return workers > 1 && memory_size * workers <= dispatch_size && memory_size <= MAX_PRIVATE_SCATTER_SIZE;
+}
+
+inline uint* private_copy(uint* copies, size_t memory_size, uint initial)
+{
+	uint* copy = copies + (size_t)worker_id() * memory_size;
+	std::fill(copy, copy + memory_size, initial);
+	return copy;
 }
 
 inline uint pcg(uint v)
@@ -663,22 +740,109 @@ void GenerateCPPKernel(Program* program, Kernel* kernel) {
 		loop += "  " + kernel->var_types[i] + " var_" + kernel->var_names[i] + " = as" + kernel->var_types[i] + "(var[" + to_string(i) + "]);\n";
 	}
 
-	const int block_size = 4;
-	loop += "  #pragma omp parallel for\n";
-	loop += "  for (int block_id = 0; block_id < work_group_count; block_id++)\n";
-	loop += "  {\n";
+	//memory that is only accumulated into can be privatized per worker and combined at the end
+	map<Node*, size_t> memory_bindings = kernel->GetMemoryBindings();
+	map<Node*, Node*> scatter_memory;
+	unordered_set<Node*> shared_memory;
+	for (auto node = NodeIterator(kernel->root); !node.end(); node.next()) {
+		if (!node->op->HasAllTypes(OpProp::MemoryOp)) {
+			continue;
+		}
+		Node* memory = node->args.Get(ArgType::Memory);
+		bool is_scatter = node->op->HasAllTypes(OpProp::Scatter) && node->type == TFType::None;
+		TFType type = is_scatter ? node->args.Type(ArgType::Input) : TFType::None;
+		bool can_privatize = is_scatter && (type == TFType::Float || type == TFType::Int || type == TFType::Uint) &&
+		                     !(type == TFType::Uint && (node->name == "InterlockedMin" || node->name == "InterlockedMax"));
+		if (!can_privatize || (scatter_memory.contains(memory) && (scatter_memory[memory]->name != node->name ||
+		                       scatter_memory[memory]->args.Type(ArgType::Input) != type))) {
+			shared_memory.insert(memory);
+		} else {
+			scatter_memory[memory] = node.get();
+		}
+	}
+	vector<pair<Node*, Node*>> privatized;
+	for (auto& [memory, scatter] : scatter_memory) {
+		if (!shared_memory.contains(memory) && memory_bindings.contains(memory)) {
+			privatized.push_back({memory, scatter});
+		}
+	}
+
+	size_t group_threads = 1;
+	for (int size : kernel->root->group_size) {
+		group_threads *= size;
+	}
+
+	string region_indent = privatized.empty() ? "  " : "    ";
+	string loop_code = region_indent + "for (int block_id = 0; block_id < work_group_count; block_id++)\n";
+	loop_code += region_indent + "{\n";
 	for (int d = 0; d < kernel->root->group_size.size(); d++) {
 		int dim = (int)kernel->root->group_size.size() - d - 1;
-		loop += "    for (int block_thread_id" + to_string(dim) +
+		loop_code += region_indent + "  for (int block_thread_id" + to_string(dim) +
 		        " = 0; block_thread_id" + to_string(dim) + " < " +
 		        to_string(kernel->root->group_size[d]) + "; block_thread_id" +
 		        to_string(dim) + "++)\n";
 	}
-	loop += "    {\n";
-	string loop_end = "    }\n";
-	loop_end += "  }\n";
-	loop += AddIndent(kernel_code, "      ");
-	loop += loop_end;
+	loop_code += region_indent + "  {\n";
+	loop_code += AddIndent(kernel_code, region_indent + "    ");
+	loop_code += region_indent + "  }\n";
+	loop_code += region_indent + "}\n";
+
+	if (privatized.empty()) {
+		loop += "  #pragma omp parallel for\n";
+		loop += loop_code;
+	} else {
+		loop += "  int tf_workers = worker_count();\n";
+		loop += "  size_t tf_dispatch_size = (size_t)work_group_count * " + to_string(group_threads) + ";\n";
+		for (auto& [memory, scatter] : privatized) {
+			string name = memory->var_name;
+			string size = "mem_size[" + to_string(memory_bindings[memory]) + "]";
+			loop += "  uint* " + name + "_shared = " + name + "_mem;\n";
+			loop += "  bool " + name + "_private = privatize_scatter(" + size + ", tf_workers, tf_dispatch_size);\n";
+			loop += "  std::unique_ptr<uint[]> " + name + "_copies(" + name + "_private ? new uint[(size_t)" + size + " * tf_workers] : nullptr);\n";
+		}
+		loop += "  #pragma omp parallel\n";
+		loop += "  {\n";
+		//every worker of the team fills its own copy, so only the copies of the team are combined
+		loop += "    int tf_team = team_size();\n";
+		for (auto& [memory, scatter] : privatized) {
+			string name = memory->var_name;
+			string size = "mem_size[" + to_string(memory_bindings[memory]) + "]";
+			TFType type = scatter->args.Type(ArgType::Input);
+			//the copies start at the identity of the operation, so elements a worker does not touch stay unchanged when combined
+			uint initial = 0;
+			if (scatter->name == "InterlockedMin") initial = type == TFType::Float ? 0x7F800000 : GetInitialMin(type); // +inf
+			if (scatter->name == "InterlockedMax") initial = type == TFType::Float ? 0xFF800000 : GetInitialMax(type); // -inf
+			if (scatter->name == "InterlockedAnd") initial = 0xFFFFFFFF;
+			loop += "    uint* " + name + "_mem = " + name + "_private ? private_copy(" + name + "_copies.get(), " + size + ", " + to_string(initial) + "u) : " + name + "_shared;\n";
+		}
+		loop += "    #pragma omp for schedule(static)\n";
+		loop += loop_code;
+		for (auto& [memory, scatter] : privatized) {
+			//reduce the copies of each element in worker order, so the result does not depend on the scheduling
+			string name = memory->var_name;
+			string size = "mem_size[" + to_string(memory_bindings[memory]) + "]";
+			string type_name = type_names[scatter->args.Type(ArgType::Input)];
+			map<string, string> combine = {
+				{"InterlockedAdd", "value + copy"}, {"InterlockedMin", "min(value, copy)"}, {"InterlockedMax", "max(value, copy)"},
+				{"InterlockedAnd", "value & copy"}, {"InterlockedOr", "value | copy"}, {"InterlockedXor", "value ^ copy"},
+			};
+			loop += "    if (" + name + "_private)\n";
+			loop += "    {\n";
+			loop += "      #pragma omp for schedule(static)\n";
+			loop += "      for (int i = 0; i < (int)" + size + "; i++)\n";
+			loop += "      {\n";
+			loop += "        " + type_name + " value = ((" + type_name + "*)" + name + "_shared)[i];\n";
+			loop += "        for (int worker = 0; worker < tf_team; worker++)\n";
+			loop += "        {\n";
+			loop += "          " + type_name + " copy = ((" + type_name + "*)" + name + "_copies.get())[(size_t)worker * " + size + " + i];\n";
+			loop += "          value = " + combine[scatter->name] + ";\n";
+			loop += "        }\n";
+			loop += "        ((" + type_name + "*)" + name + "_shared)[i] = value;\n";
+			loop += "      }\n";
+			loop += "    }\n";
+		}
+		loop += "  }\n";
+	}
 
 	string kernel_source =
 	    "\n"
@@ -688,7 +852,7 @@ void GenerateCPPKernel(Program* program, Kernel* kernel) {
 		#endif
 	    "void " +
 	    kernel->kernel_name_ +
-	    "(uint* var, uint** mem, uint work_group_count)\n"
+	    "(uint* var, uint** mem, uint* mem_size, uint work_group_count)\n"
 	    "{\n" + loop +
 	    "}\n";
 
@@ -67,6 +67,12 @@ float pcgf(uint v) {
   return float(pcg(v)) / float(0xffffffffu);
 }
 
+uint fastdiv(uint n, uint m, uint l) {
+  uint t, lo;
+  umulExtended(n, m, t, lo);
+  return (t + ((n - t) >> min(l, 1u))) >> (max(l, 1u) - 1u);
+}
+
 float asfloat(uint x) {
   return uintBitsToFloat(x);
 }
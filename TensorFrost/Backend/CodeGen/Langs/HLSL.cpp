@@ -53,6 +53,21 @@ float pcgf(uint v)
 	return float(pcg(v)) / float(0xffffffffu);
 }
 
+uint umulhi(uint a, uint b)
+{
+	uint a_lo = a & 0xffffu, a_hi = a >> 16;
+	uint b_lo = b & 0xffffu, b_hi = b >> 16;
+	uint hi_lo = a_hi * b_lo;
+	uint cross = ((a_lo * b_lo) >> 16) + (hi_lo & 0xffffu) + a_lo * b_hi;
+	return a_hi * b_hi + (hi_lo >> 16) + (cross >> 16);
+}
+
+uint fastdiv(uint n, uint m, uint l)
+{
+	uint t = umulhi(n, m);
+	return (t + ((n - t) >> min(l, 1u))) >> (max(l, 1u) - 1u);
+}
+
 float InterlockedAddF(RWStructuredBuffer<uint> buffer, int index, float val)
 {
     uint uval = asuint(val), tmp0 = 0, tmp1 = 0;
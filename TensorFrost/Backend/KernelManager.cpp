@@ -33,6 +33,28 @@ vector<tuple<tuple<string, string, string>, vector<tuple<string, string>>>> Kern
     return kernels;
 }
 
+void KernelManager::BeginRegion(Program* program, const string& name) {
+    region_stack[program].push_back({name, chrono::steady_clock::now()});
+}
+
+void KernelManager::EndRegion(Program* program, const string& name) {
+    auto& stack = region_stack[program];
+    // profiling could have been enabled in the middle of the region
+    if (stack.empty() || stack.back().first != name) {
+        return;
+    }
+    auto end = chrono::steady_clock::now();
+    double time = (double)chrono::duration_cast<chrono::nanoseconds>(end - stack.back().second).count() / 1000000.0;
+    region_stats[program][name].Add(time);
+    stack.pop_back();
+}
+
+void KernelManager::ResetProfiling() {
+    kernel_stats.clear();
+    region_stats.clear();
+    region_stack.clear();
+}
+
 KernelManager* global_kernel_manager = nullptr;
 
 }  // namespace TensorFrost
\ No newline at end of file
@@ -7,24 +7,54 @@
 #include <unordered_map>
 #include <utility>
 #include <vector>
+#include <chrono>
+#include <float.h>
 
 #include "Compiler/KernelGen.h"
 #include "TensorMemory.h"
 
 namespace TensorFrost {
 
+struct TimingStats {
+	size_t count = 0;
+	double total_time = 0.0; // ms
+	double min_time = DBL_MAX;
+	double max_time = 0.0;
+	size_t work_groups = 0;
+
+	void Add(double time, size_t work_group_count = 0) {
+		count++;
+		total_time += time;
+		min_time = std::min(min_time, time);
+		max_time = std::max(max_time, time);
+		work_groups += work_group_count;
+	}
+};
+
 class KernelManager
 {
 	unordered_set<Program*> programs;
 	unordered_map<size_t, Kernel*> kernel_map;
 	size_t global_kernel_id = 0;
+
+	map<Program*, vector<pair<string, chrono::steady_clock::time_point>>> region_stack;
  public:
+	bool profiling_enabled = false;
+	unordered_map<size_t, TimingStats> kernel_stats;
+	map<Program*, map<string, TimingStats>> region_stats;
 
 	KernelManager() = default;
 	virtual void DispatchKernel(TFDispatchInfo info) = 0;
 	void AddKernelID(Program* program, Kernel* kernel);
 	vector<string> GetAllMainFunctions();
 
+	void RecordDispatch(size_t kernel_id, double time, size_t work_group_count) {
+		kernel_stats[kernel_id].Add(time, work_group_count);
+	}
+	void BeginRegion(Program* program, const string& name);
+	void EndRegion(Program* program, const string& name);
+	void ResetProfiling();
+
 	vector<tuple<tuple<string, string, string>, vector<tuple<string, string>>>> GetAllKernels();
 	Kernel* GetKernel(size_t kernel_id) { return kernel_map[kernel_id]; }
 };
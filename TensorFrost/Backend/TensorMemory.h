@@ -65,7 +65,7 @@ extern "C" {
 		void* custom_data;
 	};
 
-	typedef void cpu_dispatch_func(const uint32_t* var, uint32_t** mem, uint work_group_count);
+	typedef void cpu_dispatch_func(const uint32_t* var, uint32_t** mem, const uint32_t* mem_size, uint work_group_count);
 	typedef void main_func(TFTensor*, TFTensor*, TFRuntime);
 }
 
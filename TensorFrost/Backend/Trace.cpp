@@ -0,0 +1,98 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace TensorFrost {
+
+//read by the kernel worker threads without taking the lock
+atomic<bool> tracing = false;
+chrono::steady_clock::time_point trace_start;
+vector<string> trace_events;
+mutex trace_mutex;
+
+string EscapeJSON(const string& str) {
+	string result;
+	for (char c : str) {
+		switch (c) {
+			case '"': result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n"; break;
+			case '\t': result += "\\t"; break;
+			default:
+				if ((unsigned char)c >= 0x20) result += c;
+				break;
+		}
+	}
+	return result;
+}
+
+size_t GetThreadID() {
+	return hash<thread::id>()(this_thread::get_id()) % 1000000;
+}
+
+void AddTraceEvent(const string& event) {
+	lock_guard<mutex> lock(trace_mutex);
+	trace_events.push_back(event);
+}
+
+void StartTrace() {
+	lock_guard<mutex> lock(trace_mutex);
+	trace_events.clear();
+	trace_start = chrono::steady_clock::now();
+	tracing = true;
+}
+
+void StopTrace(const string& path) {
+	lock_guard<mutex> lock(trace_mutex);
+	tracing = false;
+
+	ofstream file(path);
+	if (!file) {
+		throw std::runtime_error("Trace: cannot open file " + path + " for writing");
+	}
+	file << "{\"traceEvents\": [\n";
+	for (size_t i = 0; i < trace_events.size(); i++) {
+		file << trace_events[i];
+		if (i != trace_events.size() - 1) file << ",";
+		file << "\n";
+	}
+	file << "], \"displayTimeUnit\": \"ms\"}\n";
+	trace_events.clear();
+}
+
+bool IsTracing() { return tracing; }
+
+double TraceTimestamp() {
+	auto now = chrono::steady_clock::now();
+	return (double)chrono::duration_cast<chrono::nanoseconds>(now - trace_start).count() / 1000.0;
+}
+
+void TraceRegion(const string& name, bool begin) {
+	if (!tracing) return;
+	AddTraceEvent("{\"name\": \"" + EscapeJSON(name) + "\", \"cat\": \"region\", \"ph\": \"" + (begin ? "B" : "E") +
+	              "\", \"ts\": " + to_string(TraceTimestamp()) + ", \"pid\": 1, \"tid\": " + to_string(GetThreadID()) + "}");
+}
+
+void TraceComplete(const string& name, const string& category, double start, double duration, const string& args) {
+	if (!tracing) return;
+	AddTraceEvent("{\"name\": \"" + EscapeJSON(name) + "\", \"cat\": \"" + category + "\", \"ph\": \"X\", \"ts\": " +
+	              to_string(start) + ", \"dur\": " + to_string(duration) + ", \"pid\": 1, \"tid\": " +
+	              to_string(GetThreadID()) + ", \"args\": {" + args + "}}");
+}
+
+string TraceArg(const string& name, const string& value) {
+	return "\"" + name + "\": \"" + EscapeJSON(value) + "\"";
+}
+
+string TraceArg(const string& name, size_t value) {
+	return "\"" + name + "\": " + to_string(value);
+}
+
+}  // namespace TensorFrost
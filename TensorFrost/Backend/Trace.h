@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+namespace TensorFrost {
+
+using namespace std;
+
+// Chrome trace event format recorder, the output can be opened in Perfetto or chrome://tracing
+void StartTrace();
+void StopTrace(const string& path);
+bool IsTracing();
+
+// microseconds since the start of the trace
+double TraceTimestamp();
+void TraceRegion(const string& name, bool begin);
+void TraceComplete(const string& name, const string& category, double start, double duration, const string& args);
+
+// escapes a string for use inside a JSON string literal
+string EscapeJSON(const string& str);
+
+string TraceArg(const string& name, const string& value);
+string TraceArg(const string& name, size_t value);
+
+// records a complete event spanning the lifetime of the scope
+class TraceScope {
+	bool active;
+	double start = 0.0;
+	string category;
+
+ public:
+	string name;
+	string args;
+
+	TraceScope(string name, string category)
+	    : active(IsTracing()), category(std::move(category)), name(std::move(name)) {
+		if (active) start = TraceTimestamp();
+	}
+
+	void AddArg(const string& arg) {
+		if (!active) return;
+		if (!args.empty()) args += ", ";
+		args += arg;
+	}
+
+	bool Active() const { return active; }
+
+	~TraceScope() {
+		if (active) TraceComplete(name, category, start, TraceTimestamp() - start, args);
+	}
+};
+
+}  // namespace TensorFrost
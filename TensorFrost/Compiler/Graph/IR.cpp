@@ -23,6 +23,11 @@ void IR::RemoveNode(Node* node) {
         }
 
         node->next->prev = node->prev;
+
+        node_count--;
+        if (node->name == "kernel") {
+            kernel_count--;
+        }
         delete node;
     }
 }
@@ -31,25 +36,21 @@ void IR::RemoveNode(Node* node) {
 
 void IR::RunCompilationPass(string pass_name, const function<void()>& expression, bool print, bool update_graph) {
 	current_pass = pass_name;
-#ifdef PROFILE_COMPILATION
+	int nodes_before = node_count;
 	auto start = std::chrono::high_resolution_clock::now();
-#endif
 
 	expression();
 
-#ifdef PROFILE_COMPILATION
 	auto end = std::chrono::high_resolution_clock::now();
 	float duration = (float) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
 
 	PassStats stats;
 	stats.pass_name = pass_name;
 	stats.duration = duration;
-	stats.node_count = 0;
-	for (auto node = begin(); !node.end(); node.next()) {
-		stats.node_count++;
-	}
+	stats.nodes_before = nodes_before;
+	stats.nodes_after = node_count;
+	stats.kernel_count = kernel_count;
 	pass_stats.push_back(stats);
-#endif
 
 	if (update_graph) {
 		UpdateGraph();
@@ -61,11 +62,54 @@ void IR::RunCompilationPass(string pass_name, const function<void()>& expression
 	current_pass = "";
 }
 
+#define MAX_LOAD_FUSION_ITERATIONS 64
+
+void IR::FuseKernelLoads() {
+	//the first iteration goes over all kernels, after that only the kernels whose loads changed are revisited
+	unordered_set<Node*> worklist;
+	unordered_map<Node*, size_t> signatures = GetKernelLoadSignatures();
+	for (int i = 0; i < MAX_LOAD_FUSION_ITERATIONS; i++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		int nodes_before = node_count;
+
+		RunCompilationPass("AddKernelGlobalLoadOperations", [&]() { AddKernelGlobalLoadOperations(worklist); });
+		RunCompilationPass("AddMemoryOpIndices", [&]() { AddMemoryOpIndices(worklist); });
+		RunCompilationPass("OptimizeKernelLoadOperations", [&]() { OptimizeKernelLoadOperations(worklist); });
+		RunCompilationPass("RemoveUnusedOperations", [&]() { RemoveUnusedOperations(); });
+
+		unordered_map<Node*, size_t> new_signatures = GetKernelLoadSignatures();
+		worklist.clear();
+		for (auto& [kernel, signature] : new_signatures) {
+			if (!signatures.contains(kernel) || signatures[kernel] != signature) {
+				worklist.insert(kernel);
+			}
+		}
+		signatures = new_signatures;
+
+		auto end = std::chrono::high_resolution_clock::now();
+		PassStats stats;
+		stats.pass_name = "Load fusion iteration " + to_string(i);
+		stats.duration = (float)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+		stats.nodes_before = nodes_before;
+		stats.nodes_after = node_count;
+		stats.kernel_count = kernel_count;
+		pass_stats.push_back(stats);
+
+		//fixed point reached
+		if (worklist.empty()) {
+			break;
+		}
+	}
+}
+
 void IR::CompileIR()
 {
 	// TODO (Moroz): Add auto tests into build system
 	CheckIR("Input", false, false);
 	RunCompilationPass("GetInputList", [&]() { GetInputList(); });
+	if (!specialized_input_shapes.empty()) {
+		RunCompilationPass("SpecializeInputShapes", [&]() { SpecializeInputShapes(); });
+	}
 	RunCompilationPass("OptimizeOperations", [&]() { OptimizeOperations(); });
 	RunCompilationPass("UnrollLoops", [&]() { UnrollLoops(); }, true);
 	RunCompilationPass("TryReplaceModificationsWithVersions", [&]() { TryReplaceModificationsWithVersions(); }, true);
@@ -91,23 +135,24 @@ void IR::CompileIR()
 	RunCompilationPass("UnrollLoops", [&]() { UnrollLoops(4); });
 	RunCompilationPass("TryReplaceModificationsWithVersions", [&]() { TryReplaceModificationsWithVersions(); }, true);
 	RunCompilationPass("RemoveUnusedOperations", [&]() { RemoveUnusedOperations(); });
-	RunCompilationPass("Load fusion", [&]() {
-		for (int i = 0; i < 20; i++) {
-			RunCompilationPass("AddKernelGlobalLoadOperations", [&]() { AddKernelGlobalLoadOperations(); });
-			RunCompilationPass("AddMemoryOpIndices", [&]() { AddMemoryOpIndices(); });
-			RunCompilationPass("OptimizeKernelLoadOperations", [&]() { OptimizeKernelLoadOperations(); });
-			RunCompilationPass("RemoveUnusedOperations", [&]() { RemoveUnusedOperations(); });
-		}
-	});
+	RunCompilationPass("Load fusion", [&]() { FuseKernelLoads(); });
+	RunCompilationPass("EliminateCommonSubexpressions", [&]() { EliminateCommonSubexpressions(); });
 	RunCompilationPass("AddKernelGlobalStoreOperations", [&]() { AddKernelGlobalStoreOperations(); });
 	RunCompilationPass("RemoveUnusedKernels", [&]() { RemoveUnusedKernels(); }, true);
+	RunCompilationPass("FuseIndependentKernels", [&]() { FuseIndependentKernels(); });
 	RunCompilationPass("AddMemoryOpIndices", [&]() { AddMemoryOpIndices(); });
 	RunCompilationPass("ReorderOperations", [&]() { ReorderOperations(); });
 	RunCompilationPass("OptimizeOperations", [&]() { OptimizeOperations(); });
 	RunCompilationPass("AddMemoryOpIndices", [&]() { AddMemoryOpIndices(); }, true);
+	RunCompilationPass("OptimizeIndexingModes", [&]() { OptimizeIndexingModes(); });
 	RunCompilationPass("FinalizeMemoryIndexing", [&]() { FinalizeMemoryIndexing(); });
+	RunCompilationPass("EliminateCommonSubexpressions", [&]() { EliminateCommonSubexpressions(); });
+	RunCompilationPass("MoveLoopInvariants", [&]() { MoveLoopInvariants(); });
+	RunCompilationPass("StrengthReduceLoopIndices", [&]() { StrengthReduceLoopIndices(); });
+	RunCompilationPass("OptimizeOperations", [&]() { OptimizeOperations(); });
 	RunCompilationPass("RemoveUnusedOperations", [&]() { RemoveUnusedOperations(); });
 	RunCompilationPass("OptimizeKernels", [&]() { OptimizeKernels(); });
+	RunCompilationPass("OptimizeInvariantDivisions", [&]() { OptimizeInvariantDivisions(); });
 	RunCompilationPass("OptimizeHost", [&]() { OptimizeHost(); });
 	RunCompilationPass("RemoveUnusedOperations", [&]() { RemoveUnusedOperations(); });
 	RunCompilationPass("AddMemoryDeallocation", [&]() { AddMemoryDeallocation(); }, true);
@@ -117,7 +162,7 @@ void IR::CompileIR()
 #ifdef PROFILE_COMPILATION
 	cout << "Profiled compilation passes:" << endl;
 	for (const PassStats& stats : pass_stats) {
-		cout << "Pass: " << stats.pass_name << " took " << stats.duration << "ms and processed " << stats.node_count << " nodes" << endl;
+		cout << "Pass: " << stats.pass_name << " took " << stats.duration << "ms, nodes " << stats.nodes_before << " -> " << stats.nodes_after << ", kernels " << stats.kernel_count << endl;
 	}
 #endif
 }
@@ -131,4 +176,9 @@ int GetAxis(int dims, int axis)
 	return axis;
 }
 
+void HashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 }  // namespace TensorFrost
\ No newline at end of file
@@ -66,6 +66,11 @@ public:
 			cursor.go_to_next();
         }
 
+		node_count++;
+		if (newNode->name == "kernel") {
+			kernel_count++;
+		}
+
 #ifndef NDEBUG
 		newNode->created_in = current_pass;
 #endif
@@ -157,6 +162,7 @@ public:
 	map<Node*, Node*> CopyComputation(const unordered_set<Node*>& targets,
 	                                  const unordered_map<int, Node*>& indices);
 	void GetInputList();
+	void SpecializeInputShapes();
 	void GetOutputList();
 	void ComputeStatistics();
 	void CopyArguments(ArgEdges args_to_copy, Node *cursor);
@@ -165,9 +171,15 @@ public:
 	void ReorderOperations();
 	void MoveShapeOutsideKernels();
 	void OptimizeKernels();
+	void FuseIndependentKernels();
 	void OptimizeHost();
 	void OptimizeOperations();
-	void OptimizeKernelLoadOperations();
+	void EliminateCommonSubexpressions();
+	void MoveLoopInvariants();
+	void StrengthReduceLoopIndices();
+	void OptimizeIndexingModes();
+	void OptimizeInvariantDivisions();
+	void OptimizeKernelLoadOperations(const unordered_set<Node*>& worklist = {});
 	void OptimizeReductions();
 
 	unordered_set<Node *> GetDependencies(unordered_set<Node *> nodes);
@@ -179,6 +191,9 @@ public:
 	void UnrollAtomicOperations();
 	void TryReplaceModificationsWithVersions();
 	void ComputeAutodiff();
+	void ComputeBackwardGradients();
+	void ComputeForwardGradients();
+	void RematerializeForwardValues(Node* backward_begin, Node* backward_end, bool automatic);
 	void SeparateOperationsIntoKernels();
 	void ComputeNodeCost();
 
@@ -187,8 +202,10 @@ public:
 
 	map<Node *, ArgEdges> GetKernelOutputs(Node *kernel);
 	void AddNodeLoadOperations(Node* node, Node* kernel, Tensors indices);
-	void AddKernelGlobalLoadOperations();
-	void AddMemoryOpIndices();
+	void AddKernelGlobalLoadOperations(const unordered_set<Node*>& worklist = {});
+	void AddMemoryOpIndices(const unordered_set<Node*>& worklist = {});
+	unordered_map<Node*, size_t> GetKernelLoadSignatures();
+	size_t GetKernelSignature(Node* kernel) const;
 	void AddKernelGlobalStoreOperations();
 	void CheckKernelShapes();
 	void AddMemoryDeallocation();
@@ -201,6 +218,7 @@ public:
 
 	void ComputeAddress(Node *node, vector<Tensor *> indices);
 
+	void FuseKernelLoads();
 	void FinalizeMemoryIndexing();
 	void RemoveUnusedKernels();
 	void CompileIR();
@@ -293,6 +311,25 @@ public:
 		return result;
 	}
 
+	//returns the kernels from the worklist, or all kernels if the worklist is empty
+	vector<Node*> GetKernels(const unordered_set<Node*>& worklist = {}) const {
+		vector<Node*> result;
+		for (auto node = begin(); !node.end(); node.next()) {
+			if (node->name == "kernel" && (worklist.empty() || worklist.contains(*node))) {
+				result.push_back(*node);
+			}
+		}
+		return result;
+	}
+
+	int GetNodeCount() const {
+		int count = 0;
+		for (auto node = begin(); !node.end(); node.next()) {
+			count++;
+		}
+		return count;
+	}
+
 	vector<Node*> GetChildren(Node* node) const {
 		vector<Node*> result;
 		for (auto child = NodeIterator(node); !child.end(); child.next()) {
@@ -314,14 +351,34 @@ public:
 
 	string current_pass;
 
+	//kept up to date by AddNode and RemoveNode, so the pass statistics don't need to walk the graph
+	int node_count = 0;
+	int kernel_count = 0;
+
 	struct PassStats {
 		string pass_name;
 		float duration;
-		int node_count;
+		int nodes_before;
+		int nodes_after;
+		int kernel_count;
 	};
 	vector<PassStats> pass_stats;
+
+	// work group sizes to use instead of the defaults, by kernel signature (used by the autotuner)
+	unordered_map<size_t, vector<int>> group_size_overrides;
+
+	// known input shapes by input index, replace the input_shape nodes with constants if set
+	unordered_map<int, vector<int>> specialized_input_shapes;
 };
 
 int GetAxis(int dims, int axis);
+//mix a value into a running hash
+void HashCombine(size_t& seed, size_t value);
+vector<int> GetDefaultGroupSize(int dims);
+//has no side effects and its value only depends on its arguments, algorithm operations only count if allowed
+bool IsPureOperation(Node* node, bool allow_algorithms = false);
+
+//recompute forward values in the backward pass instead of keeping them, on by default
+extern bool rematerialize_forward_values;
 
 }  // namespace TensorFrost
\ No newline at end of file
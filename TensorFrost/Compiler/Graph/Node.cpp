@@ -205,7 +205,8 @@ const map<NodeProp, string> flag_names = {
     {NodeProp::KeepDims, "KeepDims"}, {NodeProp::IsStatic, "IsStatic"},
     {NodeProp::OutputMemory, "OutputMemory"}, {NodeProp::InputMemory, "InputMemory"},
     {NodeProp::InputMemoryList, "InputMemoryList"}, {NodeProp::InputShapeMemory, "InputShapeMemory"},
-    {NodeProp::InputShapeDim, "InputShapeDim"},
+    {NodeProp::InputShapeDim, "InputShapeDim"}, {NodeProp::InBounds, "InBounds"},
+    {NodeProp::Checkpoint, "Checkpoint"},
 };
 
 string NodeFlagsToString(NodeProp flags) {
@@ -18,6 +18,8 @@ enum class NodeProp {
 	KeepDims,
 	DetachGrad,
 	PassGrad,
+	InBounds,
+	Checkpoint,
 	Count,
 };
 
@@ -65,6 +67,7 @@ class Node {
 	std::vector<uint> data;
 	IndexingMode indexing_mode_; //clamp unless otherwise specified
 	vector<int> group_size; //kernel properties
+	size_t signature = 0;
 
 #ifndef NDEBUG
 	string created_in;
@@ -15,6 +15,7 @@ Program* GenerateProgram(IR* ir)
 		// get the kernel type
 		map<Node*, size_t> variables;
 		map<Node*, bool> read_write;
+		vector<Node*> memory_order; // bindings follow the first use, so the same kernel always gets the same code
 		NodeArguments shape = kernel->args.GetArguments(ArgType::Shape);
 		size_t variable_index = 0;
 
@@ -22,6 +23,9 @@ Program* GenerateProgram(IR* ir)
 			if (node->op->HasAllTypes(OpProp::MemoryOp)) {
 				// get the memory node
 				const Tensor* memory = node->args.GetTensor(ArgType::Memory);
+				if (!read_write.contains(memory->node_)) {
+					memory_order.push_back(memory->node_);
+				}
 
 				if(node->op->HasAllTypes(OpProp::Modifier)) {
 					read_write[memory->node_] |= true;
@@ -46,8 +50,8 @@ Program* GenerateProgram(IR* ir)
 		map<Node*, size_t> read_only_memory;
 		size_t read_write_index = 0;
 		size_t read_only_index = 0;
-		for(auto [node, rw] : read_write) {
-			if(rw) {
+		for(Node* node : memory_order) {
+			if(read_write[node]) {
 				read_write_memory[node] = read_write_index++;
 			} else {
 				read_only_memory[node] = read_only_index++;
@@ -61,4 +65,196 @@ Program* GenerateProgram(IR* ir)
 	return program;
 }
 
-}  // namespace TensorFrost
\ No newline at end of file
+struct HostValue {
+	string expr;
+	double value = 0.0;
+	bool known = false;
+};
+
+using HostValueCache = map<Node*, HostValue>;
+
+HostValue EvaluateHostValue(IR* ir, Node* node, const vector<vector<int>>& input_shapes, HostValueCache& cache);
+
+HostValue ComputeHostValue(IR* ir, Node* node, const vector<vector<int>>& input_shapes, HostValueCache& cache) {
+	HostValue result;
+	if (node->name == "const") {
+		result.value = node->type == TFType::Float ? AsFloat(node->data[0]) : (double)AsInt(node->data[0]);
+		result.known = true;
+		result.expr = to_string((int)result.value);
+		return result;
+	}
+
+	if (node->name == "input_shape") {
+		int memory = node->flags.get(NodeProp::InputShapeMemory, false);
+		int dim = node->flags.get(NodeProp::InputShapeDim, false);
+		string memory_name = "input" + to_string(memory);
+		if (ir->input_memory_map.contains(memory) && !ir->input_memory_map[memory]->var_name.empty()) {
+			memory_name = ir->input_memory_map[memory]->var_name;
+		}
+		result.expr = memory_name + ".shape[" + to_string(dim) + "]";
+		if (memory >= 0 && memory < input_shapes.size() && dim >= 0 && dim < input_shapes[memory].size()) {
+			result.value = input_shapes[memory][dim];
+			result.known = true;
+		}
+		return result;
+	}
+
+	static const map<string, string> binary_ops = {
+	    {"add", "+"}, {"sub", "-"}, {"mul", "*"}, {"div", "/"}, {"min", "min"}, {"max", "max"},
+	};
+	auto op = binary_ops.find(node->name);
+	if (op != binary_ops.end()) {
+		HostValue a = EvaluateHostValue(ir, node->args.Get(ArgType::Input, 0), input_shapes, cache);
+		HostValue b = EvaluateHostValue(ir, node->args.Get(ArgType::Input, 1), input_shapes, cache);
+		if (op->first == "min" || op->first == "max") {
+			result.expr = op->second + "(" + a.expr + ", " + b.expr + ")";
+		} else {
+			result.expr = "(" + a.expr + " " + op->second + " " + b.expr + ")";
+		}
+		result.known = a.known && b.known && !(op->first == "div" && b.value == 0.0);
+		if (result.known) {
+			if (op->first == "add") result.value = a.value + b.value;
+			else if (op->first == "sub") result.value = a.value - b.value;
+			else if (op->first == "mul") result.value = a.value * b.value;
+			else if (op->first == "div") result.value = node->type == TFType::Float ? a.value / b.value : floor(a.value / b.value);
+			else if (op->first == "min") result.value = std::min(a.value, b.value);
+			else result.value = std::max(a.value, b.value);
+		}
+		return result;
+	}
+
+	if (node->op->class_ == OpClass::Copy || node->op->class_ == OpClass::TypeCast) {
+		return EvaluateHostValue(ir, node->args.Get(ArgType::Input, 0), input_shapes, cache);
+	}
+
+	result.expr = node->var_name.empty() ? node->name : node->var_name;
+	return result;
+}
+
+//evaluate a host side integer expression (shapes, loop bounds) given the input shapes,
+//shared subexpressions are evaluated once
+HostValue EvaluateHostValue(IR* ir, Node* node, const vector<vector<int>>& input_shapes, HostValueCache& cache) {
+	auto cached = cache.find(node);
+	if (cached != cache.end()) {
+		return cached->second;
+	}
+	HostValue result = ComputeHostValue(ir, node, input_shapes, cache);
+	cache[node] = result;
+	return result;
+}
+
+bool IsSpecialFunction(const string& name) {
+	static const unordered_set<string> special_functions = {
+	    "exp", "exp2", "log", "log2", "sqrt", "rsqrt", "rcp", "sin", "cos", "tan",
+	    "asin", "acos", "atan", "sinh", "cosh", "tanh", "pow", "atan2",
+	};
+	return special_functions.contains(name);
+}
+
+void AccumulateKernelCost(IR* ir, Node* parent, double multiplier, KernelCostReport& report,
+                          const vector<vector<int>>& input_shapes, HostValueCache& cache) {
+	for (Node* node = parent->child; node->valid(); node = node->next) {
+		if (node->name == "loop") {
+			HostValue begin = EvaluateHostValue(ir, node->args.Get(ArgType::Input, 0), input_shapes, cache);
+			HostValue end = EvaluateHostValue(ir, node->args.Get(ArgType::Input, 1), input_shapes, cache);
+			HostValue step = EvaluateHostValue(ir, node->args.Get(ArgType::Input, 2), input_shapes, cache);
+			string trip_expr = "(" + end.expr + " - " + begin.expr + ") / " + step.expr;
+			report.loop_trip_exprs.push_back(trip_expr);
+
+			double trips = 1.0;
+			if (begin.known && end.known && step.known && step.value != 0.0) {
+				trips = std::max(0.0, ceil((end.value - begin.value) / step.value));
+			} else {
+				report.exact = false;
+			}
+			AccumulateKernelCost(ir, node, multiplier * trips, report, input_shapes, cache);
+			continue;
+		}
+
+		const Operation* op = node->op;
+		if (op->HasAllTypes(OpProp::Scatter)) {
+			report.atomics += multiplier;
+		} else if (op->HasAllTypes(OpProp::Load)) {
+			report.loads += multiplier;
+		} else if (op->HasAllTypes(OpProp::Store)) {
+			report.stores += multiplier;
+		} else if (op->class_ == OpClass::Operator || op->class_ == OpClass::UnaryOperator ||
+		           op->class_ == OpClass::Function || op->class_ == OpClass::TernaryOperator) {
+			if (node->type == TFType::Float) {
+				if (IsSpecialFunction(node->name)) {
+					report.special_ops += multiplier;
+				} else {
+					report.flops += multiplier;
+				}
+			} else if (node->type == TFType::Int || node->type == TFType::Uint) {
+				report.int_ops += multiplier;
+			}
+		}
+
+		if (node->child->valid()) {
+			AccumulateKernelCost(ir, node, multiplier, report, input_shapes, cache);
+		}
+	}
+}
+
+// every element in memory is 4 bytes, atomics both read and write
+double KernelCostReport::BytesPerThread() const {
+	return 4.0 * (loads + stores + 2.0 * atomics);
+}
+
+double KernelCostReport::ArithmeticIntensity() const {
+	double bytes = BytesPerThread();
+	return bytes > 0.0 ? (flops + special_ops) / bytes : DBL_MAX;
+}
+
+// flop per byte below which a kernel that shares memory with another kernel is worth fusing
+#define LOW_ARITHMETIC_INTENSITY 0.25
+
+vector<KernelCostReport> GetKernelCostReport(Program* program, const vector<vector<int>>& input_shapes) {
+	vector<KernelCostReport> reports;
+	for (auto& kernel : program->kernels_) {
+		KernelCostReport report;
+		report.kernel = &kernel;
+		HostValueCache cache;
+
+		report.threads = 1.0;
+		for (size_t i = 0; i < kernel.shape.size(); i++) {
+			HostValue dim = EvaluateHostValue(program->ir_, kernel.root->args.Get(ArgType::Shape, (int)i), input_shapes, cache);
+			report.threads_expr += (i > 0 ? " * " : "") + dim.expr;
+			if (!dim.known) {
+				report.threads = -1.0;
+			} else if (report.threads >= 0.0) {
+				report.threads *= dim.value;
+			}
+		}
+		if (report.threads_expr.empty()) {
+			report.threads_expr = "1";
+		}
+
+		AccumulateKernelCost(program->ir_, kernel.root, 1.0, report, input_shapes, cache);
+		reports.push_back(report);
+	}
+
+	// memory written by one kernel and read by another is a producer/consumer pair
+	map<Node*, int> writers, readers;
+	for (auto& kernel : program->kernels_) {
+		for (auto& [mem, _] : kernel.read_write_memory) writers[mem]++;
+		for (auto& [mem, _] : kernel.read_only_memory) readers[mem]++;
+	}
+
+	for (auto& report : reports) {
+		if (report.ArithmeticIntensity() >= LOW_ARITHMETIC_INTENSITY) {
+			continue;
+		}
+		for (auto& [mem, _] : report.kernel->read_only_memory) {
+			if (writers[mem] > 0) report.fusion_candidate = true;
+		}
+		for (auto& [mem, _] : report.kernel->read_write_memory) {
+			if (readers[mem] > 0 || writers[mem] > 1) report.fusion_candidate = true;
+		}
+	}
+
+	return reports;
+}
+
+}  // namespace TensorFrost
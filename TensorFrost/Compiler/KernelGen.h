@@ -55,6 +55,10 @@ class Program {
 	string main_function_;
 	string program_name = "TensorProgram";
 
+	// time spent in the external compiler and in loading the compiled library (ms)
+	float host_compile_time = 0.0f;
+	float library_load_time = 0.0f;
+
 	function<main_func> execute_callback;
 
 	explicit Program(IR* ir) : ir_(ir) {}
@@ -69,6 +73,29 @@ class Program {
 
 Program* GenerateProgram(IR* ir);
 
+struct KernelCostReport {
+	Kernel* kernel;
+
+	// per thread estimates, loop bodies are multiplied by their trip count
+	double loads = 0.0;
+	double stores = 0.0;
+	double atomics = 0.0;
+	double flops = 0.0;
+	double special_ops = 0.0;
+	double int_ops = 0.0;
+
+	string threads_expr;
+	double threads = -1.0; // -1 if the thread count could not be evaluated
+	vector<string> loop_trip_exprs;
+	bool exact = true; // false if some loop trip count was unknown and assumed to be 1
+
+	double BytesPerThread() const;
+	double ArithmeticIntensity() const;
+	bool fusion_candidate = false;
+};
+
+vector<KernelCostReport> GetKernelCostReport(Program* program, const vector<vector<int>>& input_shapes = {});
+
 bool isConstantAndEqualTo(const Tensor* tensor, float value);
 bool isConstant(const Tensor* tensor);
 Tensor* ApplyMultiOP(const Tensor* a, const Tensor* b, std::function<float(float, float)> opF32, std::function<int(int, int)> opI32, std::function<uint(uint, uint)> opU32);
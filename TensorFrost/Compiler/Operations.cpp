@@ -85,7 +85,7 @@ const vector<Operation> operations = {
 
     //Autodiff
     Operation("backwards_grad", {"ff_f"}, 0, "", {OpProp::Static, OpProp::Gradient}),
-    Operation("forward_grad", {"ff_f"}, 0, "", {OpProp::Static, OpProp::Gradient}),
+    Operation("forward_grad", {"fff_f"}, 0, "", {OpProp::Static, OpProp::Gradient}),
 
     // Memory operations
     //Operation("local_load", {"_f", "_u", "_i"}, 8, "", {OpType::Load}), // TODO implement in graph
@@ -174,6 +174,9 @@ const vector<Operation> operations = {
     Operation("tanh", {"f_f"}, 8),
     Operation("pcg", {"u_u"}, 32),
 	Operation("reversebits", {"u_u"}, 8),
+	Operation("fastdiv", {"uuu_u"}, 6, "", {OpProp::Nondiff}),
+	Operation("fastdiv_multiplier", {"u_u"}, 32, "", {OpProp::Nondiff, OpProp::HostOnly}),
+	Operation("fastdiv_shift", {"u_u"}, 8, "", {OpProp::Nondiff, OpProp::HostOnly}),
     Operation("pcgf", {"u_f"}, 34),
     Operation("pow", {"ff_f"}, 6),
     Operation("atan2", {"ff_f"}, 32),
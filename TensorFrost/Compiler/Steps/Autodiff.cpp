@@ -116,6 +116,160 @@ int GetGradAxis(const Tensor& out, const Tensor& grad) {
 }
 
 
+#define MAX_GATHER_GRADIENT_TERMS 8
+
+//memory index of the form dim_id + offset over the shape of the load
+struct AffineIndex {
+	int dim;
+	int offset;
+};
+
+bool GetAffineIndex(Node* index, Node* load, AffineIndex& result) {
+	result.offset = 0;
+	if (index->name == "add" || index->name == "sub") {
+		Node* a = index->args.Get(ArgType::Input, 0);
+		Node* b = index->args.Get(ArgType::Input, 1);
+		bool is_sub = index->name == "sub";
+		if (b->name == "const" && b->type != TFType::Float) {
+			result.offset = is_sub ? -AsInt(b->data[0]) : AsInt(b->data[0]);
+			index = a;
+		} else if (!is_sub && a->name == "const" && a->type != TFType::Float) {
+			result.offset = AsInt(a->data[0]);
+			index = b;
+		} else {
+			return false;
+		}
+	}
+	if (index->name != "dim_id" || index->flags.has(NodeProp::Modified)) {
+		return false;
+	}
+	int dims = load->args.Count(ArgType::Shape);
+	ShapeCompareResult shape = CompareShape(index, load, true);
+	if (!shape.compatible || shape.broadcast || index->args.Count(ArgType::Shape) != dims) {
+		return false;
+	}
+	result.dim = (int)index->data[0];
+	return result.dim < dims;
+}
+
+/// <summary>
+/// Compute the gradient of a load as a gather from the output gradient when every memory element is read by a known set of threads
+/// (transposes, broadcasts and constant offset stencils). This avoids atomics and makes the result deterministic.
+/// Returns false if the indexing pattern is not supported, in which case the gradient is scattered.
+/// </summary>
+bool TryGatherLoadGradient(ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
+	Node* load = out.node_;
+	const Tensor* memory = in.GetTensor(ArgType::Memory);
+	int index_count = in.Count(ArgType::Index);
+	int out_dims = load->args.Count(ArgType::Shape);
+	if (index_count == 0 || index_count != memory->GetDimension() || grad.GetDimension() != out_dims) {
+		return false;
+	}
+	ShapeCompareResult grad_shape = CompareShape(grad.node_, load, true);
+	if (!grad_shape.compatible || grad_shape.broadcast) {
+		return false;
+	}
+
+	IndexingMode mode = load->indexing_mode_;
+	vector<AffineIndex> indices(index_count);
+	vector<int> memory_dim(out_dims, -1);
+	int term_count = 1;
+	for (int k = 0; k < index_count; k++) {
+		if (!GetAffineIndex(in.Get(ArgType::Index, k), load, indices[k]) || memory_dim[indices[k].dim] != -1) {
+			return false;
+		}
+		memory_dim[indices[k].dim] = k;
+
+		//the sizes must match exactly, otherwise multiple threads are clamped to the same element
+		Node* load_size = load->args.Get(ArgType::Shape, indices[k].dim);
+		Node* memory_size = memory->node_->args.Get(ArgType::Shape, k);
+		if (!CompareShapeDim(load_size, memory_size, true).compatible) {
+			return false;
+		}
+
+		int offset = indices[k].offset;
+		if (offset != 0 && mode == IndexingMode::Mirror) {
+			return false;
+		}
+		if (offset != 0 && mode == IndexingMode::Clamp) {
+			//the edge element also gets the gradient of the threads clamped to it
+			term_count *= abs(offset) + 1;
+		}
+	}
+	if (term_count > MAX_GATHER_GRADIENT_TERMS) {
+		return false;
+	}
+
+	//sum the gradient over the dimensions that are not used to index the memory
+	const Tensor* reduced = &grad;
+	for (int dim = out_dims - 1; dim >= 0; dim--) {
+		if (memory_dim[dim] == -1) {
+			reduced = &Tensor::Sum(*reduced, dim);
+		}
+	}
+	vector<int> reduced_dim(out_dims, -1);
+	for (int dim = 0, position = 0; dim < out_dims; dim++) {
+		if (memory_dim[dim] != -1) {
+			reduced_dim[dim] = position++;
+		}
+	}
+
+	Tensors memory_shape = memory->GetShape();
+	Tensor* gradient = nullptr;
+	for (int term = 0; term < term_count; term++) {
+		Tensors gather_indices = Tensors(index_count);
+		Tensor* valid = nullptr;
+		int remaining = term;
+		for (int k = 0; k < index_count; k++) {
+			const Tensor& memory_index = Tensor::Index(memory_shape, k);
+			int offset = indices[k].offset;
+			int position = reduced_dim[indices[k].dim];
+			if (offset == 0) {
+				gather_indices[position] = &memory_index;
+				continue;
+			}
+
+			int edge_term = 0;
+			if (mode == IndexingMode::Clamp) {
+				edge_term = remaining % (abs(offset) + 1);
+				remaining /= abs(offset) + 1;
+			}
+			const Tensor& index = memory_index + Tensor::Constant(offset > 0 ? edge_term - offset : -offset - edge_term);
+			const Tensor& size = *memory_shape[k];
+			if (mode == IndexingMode::Repeat) {
+				//wrap explicitly, the load can be fused into the computation of the gradient
+				gather_indices[position] = &(((index % size) + size) % size);
+				continue;
+			}
+
+			gather_indices[position] = &index;
+			Tensor* in_range = &((index >= Tensor::Constant(0)) && (index < size));
+			if (edge_term > 0) {
+				const Tensor& edge = offset > 0 ? size - Tensor::Constant(1) : Tensor::Constant(0);
+				in_range = &(*in_range && (memory_index == edge));
+			}
+			valid = valid ? &(*valid && *in_range) : in_range;
+		}
+
+		Tensor* value = &Tensor::Load(*reduced, gather_indices);
+		if (valid) {
+			value = &Tensor::select(*valid, *value, Tensor::Constant(0.0f));
+		}
+		gradient = gradient ? &(*gradient + *value) : value;
+	}
+
+	grads.Add(ArgType::Memory, 0, *gradient);
+	return true;
+}
+
+//true only at the first element along the axis equal to the reduced value, so that ties get the derivative once
+const Tensor& IsFirstExtremum(const Tensor& input, const Tensor& out, int axis) {
+	Tensors shape = input.GetShape();
+	const Tensor& index = Tensor::Index(shape, axis);
+	const Tensor& candidate = Tensor::select(input == Tensor::Unsqueeze(out, axis), index, *shape[axis]);
+	return index == Tensor::Unsqueeze(Tensor::Min(candidate, axis), axis);
+}
+
 map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> gradient_functions =
 {
 	//elementwise operations
@@ -144,7 +298,7 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 	{"round", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::Constant(0.0f)); }},
 	{"frac", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::Constant(0.0f)); }},
 	{"atan2", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad * in[1] / (in[0] * in[0] + in[1] * in[1]), -grad * in[0] / (in[0] * in[0] + in[1] * in[1])); }},
-	{"lerp", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad * in[2], grad * (Tensor::Constant(1.0f) - in[2]), grad * (in[0] - in[1])); }},
+	{"lerp", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad * (Tensor::Constant(1.0f) - in[2]), grad * in[2], grad * (in[1] - in[0])); }},
 	{"max", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::select(in[0] > in[1], grad, Tensor::Constant(0.0f)), Tensor::select(in[0] < in[1], grad, Tensor::Constant(0.0f))); }},
 	{"min", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::select(in[0] < in[1], grad, Tensor::Constant(0.0f)), Tensor::select(in[0] > in[1], grad, Tensor::Constant(0.0f))); }},
 	{"pow", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad * in[1] * Tensor::pow(in[0], in[1] - Tensor::Constant(1.0f)), grad * Tensor::log(in[0]) * out); }},
@@ -157,7 +311,6 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 		grads.Add(dc_dx, dc_dmin, dc_dmax);
 	}},
 	{"ternary", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::Constant(0.0f), Tensor::select(in[0], grad, Tensor::Constant(0.0f)), Tensor::select(in[0], Tensor::Constant(0.0f), grad)); }},
-	{"lerp", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad * in[2], grad * (Tensor::Constant(1.0f) - in[2]), grad * (in[0] - in[1])); }},
 	{"smoothstep", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
 		//smoothstep equation:
 		//t = (x - e0) / (e1 - e0)
@@ -184,7 +337,7 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 		grads.Add( grad_dt * dt_de0, grad_dt * dt_de1, grad_dt * dt_dx);
 	}},
 	{"step", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(Tensor::Constant(0.0f), Tensor::Constant(0.0f)); }},
-	{"modf", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad, Tensor::Constant(0.0f)); }},
+	{"modf", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(grad, -grad * Tensor::floor(in[0] / in[1])); }},
 	{"fma", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) { grads.Add(in[1] * grad, in[0] * grad, grad); }},
 
 	//matrix operations
@@ -219,14 +372,14 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 		grads.Add(unsq * in[0]);
 	}},
 	{"dim_max", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
-		auto& out_unsq = Tensor::Unsqueeze(out, out.node_->data[0]);
-		auto& grad_unsq = Tensor::Unsqueeze(grad, out.node_->data[0]);
-		grads.Add(Tensor::select(in[0] == out_unsq, grad_unsq, Tensor::Constant(0.0f)));
+		int axis = (int)out.node_->data[0];
+		auto& grad_unsq = Tensor::Unsqueeze(grad, axis);
+		grads.Add(Tensor::select(IsFirstExtremum(in[0], out, axis), grad_unsq, Tensor::Constant(0.0f)));
 	}},
 	{"dim_min", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
-		auto& out_unsq = Tensor::Unsqueeze(out, out.node_->data[0]);
-		auto& grad_unsq = Tensor::Unsqueeze(grad, out.node_->data[0]);
-		grads.Add(Tensor::select(in[0] == out_unsq, grad_unsq, Tensor::Constant(0.0f)));
+		int axis = (int)out.node_->data[0];
+		auto& grad_unsq = Tensor::Unsqueeze(grad, axis);
+		grads.Add(Tensor::select(IsFirstExtremum(in[0], out, axis), grad_unsq, Tensor::Constant(0.0f)));
 	}},
 	{"dim_prefix_sum", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
 		//b_i = a_0 + ... + a_i
@@ -252,6 +405,10 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 	}},
 	//memory operations
 	{"load", [](ArgumentManager& in, Tensor& out, Tensor& grad, NodeGrads& grads) {
+		if (TryGatherLoadGradient(in, out, grad, grads)) {
+			return;
+		}
+
 		//derivative of load is scatter gradient to the load memory addresses
 		int index_count = in.Count(ArgType::Index);
 
@@ -301,6 +458,148 @@ map<string, function<void(ArgumentManager&, Tensor&, Tensor&, NodeGrads&)>> grad
 	}},
 };
 
+class NodeTangents
+{
+	unordered_map<ArgID, const Tensor*, HashArgID> argument_tangents;
+	unordered_map<ArgID, const Tensor*, HashArgID> argument_inputs;
+public:
+	NodeTangents(Node* node, const map<Node*, const Tensor*>& tangents) {
+		for(auto& [id, input] : node->args.inputs_) {
+			argument_inputs[id] = input->GetTensor();
+			if(tangents.contains(input)) {
+				argument_tangents[id] = tangents.at(input);
+			}
+		}
+	}
+
+	bool Any() const {
+		return !argument_tangents.empty();
+	}
+
+	//tangent of the argument, zero if it does not depend on the differentiation variable
+	const Tensor& Get(ArgID id) {
+		if(!argument_tangents.contains(id)) {
+			argument_tangents[id] = &Tensor::Constant(argument_inputs[id]->GetShape(), 0.0f);
+		}
+		return *argument_tangents[id];
+	}
+
+	const Tensor& operator[](int index) {
+		return Get(ArgID(ArgType::Input, index));
+	}
+};
+
+//apply the same linear operation to different inputs
+const Tensor& ApplyToInputs(const Tensor& out, const vector<const Tensor*>& inputs, ArgType type = ArgType::Input) {
+	NodeArguments args;
+	for (auto& [id, from] : out.node_->args.inputs_) {
+		args[id] = from;
+	}
+	for (int i = 0; i < inputs.size(); i++) {
+		args[ArgID(type, i)] = inputs[i]->node_;
+	}
+	Tensor* result = Tensor::GetCopy(out, args);
+	result->node_->flags.remove(NodeProp::OutputMemory, NodeProp::Checkpoint);
+	return *result;
+}
+
+map<string, function<const Tensor&(ArgumentManager&, Tensor&, NodeTangents&)>> tangent_functions =
+{
+	//elementwise operations
+	{"copy", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0]; }},
+	{"add", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] + d[1]; }},
+	{"sub", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] - d[1]; }},
+	{"mul", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * in[1] + in[0] * d[1]; }},
+	{"div", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / in[1] - in[0] * d[1] / (in[1] * in[1]); }},
+	{"neg", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return -d[0]; }},
+	{"exp", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * out; }},
+	{"log", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / in[0]; }},
+	{"sin", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * Tensor::cos(in[0]); }},
+	{"cos", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return -d[0] * Tensor::sin(in[0]); }},
+	{"tan", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * (Tensor::Constant(1.0f) + out * out); }},
+	{"asin", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / Tensor::sqrt(Tensor::Constant(1.0f) - in[0] * in[0]); }},
+	{"acos", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return -d[0] / Tensor::sqrt(Tensor::Constant(1.0f) - in[0] * in[0]); }},
+	{"atan", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / (Tensor::Constant(1.0f) + in[0] * in[0]); }},
+	{"sinh", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * Tensor::cosh(in[0]); }},
+	{"cosh", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * Tensor::sinh(in[0]); }},
+	{"tanh", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * (Tensor::Constant(1.0f) - out * out); }},
+	{"abs", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * Tensor::sign(in[0]); }},
+	{"sign", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::Constant(out.GetShape(), 0.0f); }},
+	{"exp2", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * Tensor::Constant(log(2.0f)) * out; }},
+	{"log2", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / (in[0] * Tensor::Constant(log(2.0f))); }},
+	{"sqrt", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] / (Tensor::Constant(2.0f) * out); }},
+	{"rsqrt", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return -d[0] * out / (Tensor::Constant(2.0f) * in[0]); }},
+	{"rcp", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return -d[0] * out * out; }},
+	{"floor", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::Constant(out.GetShape(), 0.0f); }},
+	{"ceil", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::Constant(out.GetShape(), 0.0f); }},
+	{"round", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::Constant(out.GetShape(), 0.0f); }},
+	{"frac", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0]; }},
+	{"atan2", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return (d[0] * in[1] - in[0] * d[1]) / (in[0] * in[0] + in[1] * in[1]); }},
+	{"max", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::select(in[0] > in[1], d[0], d[1]); }},
+	{"min", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::select(in[0] < in[1], d[0], d[1]); }},
+	{"pow", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * in[1] * Tensor::pow(in[0], in[1] - Tensor::Constant(1.0f)) + d[1] * Tensor::log(in[0]) * out; }},
+	{"clamp", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::select(in[0] < in[1], d[1], Tensor::select(in[0] > in[2], d[2], d[0])); }},
+	{"ternary", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::select(in[0], d[1], d[2]); }},
+	{"lerp", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * (Tensor::Constant(1.0f) - in[2]) + d[1] * in[2] + d[2] * (in[1] - in[0]); }},
+	{"smoothstep", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		//r = tc * tc * (3 - 2 * tc), tc = clamp((x - e0) / (e1 - e0), 0, 1)
+		const Tensor& e0 = in[0];
+		const Tensor& e1 = in[1];
+		const Tensor& x = in[2];
+		const Tensor& range = e1 - e0;
+		const Tensor& t = (x - e0) / range;
+		const Tensor& tc = Tensor::clamp(t, Tensor::Constant(0.0f), Tensor::Constant(1.0f));
+		const Tensor& dr_dtc = Tensor::Constant(6.0f) * tc * (Tensor::Constant(1.0f) - tc);
+		const Tensor& dt = (d[2] - d[0]) / range - (x - e0) * (d[1] - d[0]) / (range * range);
+		return dr_dtc * dt;
+	}},
+	{"step", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return Tensor::Constant(out.GetShape(), 0.0f); }},
+	{"modf", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] - Tensor::floor(in[0] / in[1]) * d[1]; }},
+	{"fma", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0] * in[1] + in[0] * d[1] + d[2]; }},
+
+	//linear operations are applied to the tangents directly
+	{"matmul", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		return ApplyToInputs(out, {&d[0], &in[1]}) + ApplyToInputs(out, {&in[0], &d[1]});
+	}},
+	{"dot", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		return ApplyToInputs(out, {&d[0], &in[1]}) + ApplyToInputs(out, {&in[0], &d[1]});
+	}},
+	{"transpose", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"unsqueeze", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"squeeze", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"dim_sum", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"dim_mean", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"dim_prefix_sum", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"dim_reverse", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return ApplyToInputs(out, {&d[0]}); }},
+	{"dim_norm", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		return Tensor::Sum(in[0] * d[0], (int)out.node_->data[0]) / out;
+	}},
+	{"dim_max", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		int axis = (int)out.node_->data[0];
+		return Tensor::Sum(Tensor::select(IsFirstExtremum(in[0], out, axis), d[0], Tensor::Constant(0.0f)), axis);
+	}},
+	{"dim_min", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		int axis = (int)out.node_->data[0];
+		return Tensor::Sum(Tensor::select(IsFirstExtremum(in[0], out, axis), d[0], Tensor::Constant(0.0f)), axis);
+	}},
+	{"reshape", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		return Tensor::Reshape(d.Get(ArgID(ArgType::Memory, 0)), out.GetShape());
+	}},
+	{"assert", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		return Tensor::Assert(d.Get(ArgID(ArgType::Memory, 0)), out.GetShape(), out.GetType());
+	}},
+	//memory operations
+	{"load", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& {
+		//tangent of a load is the load of the tangent at the same addresses
+		Tensors tensor_indices = Tensors();
+		for (int i = 0; i < in.Count(ArgType::Index); i++) {
+			tensor_indices.push_back(in.GetTensor(ArgType::Index, i));
+		}
+		return Tensor::Load(d.Get(ArgID(ArgType::Memory, 0)), tensor_indices, out.node_->indexing_mode_);
+	}},
+	{"passthrough_grad", [](ArgumentManager& in, Tensor& out, NodeTangents& d) -> const Tensor& { return d[0]; }},
+};
+
 void ComputeNodeGradients(Node* value, Tensor* grad, NodeGrads& grads)
 {
 	string op_name = value->name;
@@ -320,9 +619,194 @@ void ComputeNodeGradients(Node* value, Tensor* grad, NodeGrads& grads)
 	gradient_functions[op_name](value->args, out, *grad, grads);
 }
 
+#define MAX_REMATERIALIZATION_COST 128.0f
+
+bool rematerialize_forward_values = true;
+
+//the cost estimate does not include the reduced dimension, so these are only recomputed between checkpoints
+bool IsReducingAlgorithm(Node* node) {
+	static const unordered_set<string> reducing = {"matmul", "dot", "dim_norm", "dim_prefix_sum"};
+	return node->op->HasAllTypes(OpProp::Reduction) || reducing.contains(node->name);
+}
+
+//forward values that can be recomputed in the backward pass instead of being kept alive until it
+bool CanRematerialize(Node* node, Node* scope, bool automatic) {
+	if (node->parent != scope || node->name == "const" || node->flags.has(NodeProp::Checkpoint)) {
+		return false;
+	}
+	if (automatic && IsReducingAlgorithm(node)) {
+		return false;
+	}
+	//autodiff runs before the algorithms are lowered, so they are recomputed as a whole
+	return IsPureOperation(node, true);
+}
+
+/// <summary>
+/// Recompute the forward values used by the backward pass right before their first use in it, so they do not need to be stored.
+/// With checkpoints only the checkpointed values are kept, otherwise only cheap values are recomputed.
+/// </summary>
+void IR::RematerializeForwardValues(Node* backward_begin, Node* backward_end, bool automatic) {
+	UpdateGraph();
+	ComputeNodeCost();
+
+	Node* scope = backward_begin->parent;
+	vector<Node*> backward_nodes;
+	unordered_map<Node*, Node*> backward_top; //the top level backward node that contains the node
+	for (Node* node = backward_begin; node != backward_end; node = node->next) {
+		backward_nodes.push_back(node);
+		backward_top[node] = node;
+		for (auto child = NodeIterator(node); !child.end(); child.next()) {
+			backward_top[child.get()] = node;
+		}
+	}
+
+	unordered_map<Node*, ArgEdges> uses; //by the top level node they are in
+	for (auto& [node, top] : backward_top) {
+		for (auto& [id, from] : node->args.inputs_) {
+			if (backward_top.contains(from) || node->args.CannotCopyArgument(id) || !CanRematerialize(from, scope, automatic)) {
+				continue;
+			}
+			if (automatic && from->cost_ > MAX_REMATERIALIZATION_COST) {
+				continue;
+			}
+			uses[top].push_back(ArgEdge(Arg(id, from), node));
+		}
+	}
+
+	if (uses.empty()) {
+		return;
+	}
+
+	//values are recomputed once, right before the first part of the backward pass that needs them,
+	//so the recomputed values of later segments are not alive at the same time
+	unordered_map<Node*, Node*> rematerialized;
+	for (Node* top : backward_nodes) {
+		if (!uses.contains(top)) {
+			continue;
+		}
+
+		set<Node*> nodes_to_copy;
+		unordered_set<Node*> targets;
+		std::function<void(Node*)> dfs = [&](Node* node) {
+			if (nodes_to_copy.contains(node) || rematerialized.contains(node)) return;
+			nodes_to_copy.insert(node);
+			for (auto& [id, from] : node->args.inputs_) {
+				if (!node->args.CannotCopyArgument(id) && CanRematerialize(from, scope, automatic)) {
+					dfs(from);
+				}
+			}
+		};
+		for (auto& [arg, to] : uses[top]) {
+			if (!rematerialized.contains(arg.second)) {
+				targets.insert(arg.second);
+				dfs(arg.second);
+			}
+		}
+
+		if (!nodes_to_copy.empty()) {
+			map<Node*, Node*> copied_node_map;
+			ExecuteExpressionBefore(top, [&]() {
+				copied_node_map = CopyNodes(nodes_to_copy, rematerialized, {}, targets, false);
+			});
+			rematerialized.insert(copied_node_map.begin(), copied_node_map.end());
+		}
+
+		for (auto& [arg, to] : uses[top]) {
+			to->args.UpdateArgument(arg.first, rematerialized[arg.second]);
+		}
+	}
+
+	UpdateGraph();
+}
+
+string GetGradientName(Node* node) {
+	return node->debug_name != "" ? node->debug_name : node->var_name;
+}
+
+/// <summary>
+/// Forward mode autodiff, propagates the tangent of the differentiation variable to the function value.
+/// Only the jacobian-vector products that do not depend on reverse mode gradients that are not yet computed are processed.
+/// </summary>
+void IR::ComputeForwardGradients() {
+	vector<Node*> jvps = GetNodesOfType("forward_grad");
+
+	for (auto jvp : jvps) {
+		UpdateGraph();
+		Node* function = jvp->args.Get(ArgType::Input, 0)->GetLastVersion(jvp);
+		Node* wrt = jvp->args.Get(ArgType::Input, 1);
+		Node* direction = jvp->args.Get(ArgType::Input, 2);
+
+		unordered_set<Node*> function_deps = GetDependencies({function});
+		bool has_pending_gradients = false;
+		vector<Node*> queue;
+		for (auto dep : function_deps) {
+			has_pending_gradients |= dep->op->HasAllTypes(OpProp::Gradient);
+			bool in_range = dep->index_ > wrt->index_ && dep->index_ <= function->index_;
+			if (in_range && dep->HasCommonParents(jvp)) {
+				queue.push_back(dep);
+			}
+		}
+		if (has_pending_gradients) {
+			continue;
+		}
+
+		//sort the nodes by index in ascending order (forward propagation)
+		ranges::sort(queue.begin(), queue.end(), [](Node* a, Node* b) {
+			return a->index_ < b->index_;
+		});
+
+		map<Node*, const Tensor*> tangents;
+		tangents[wrt] = direction->GetTensor();
+		const Tensor* result = nullptr;
+		ExecuteExpressionBefore(jvp, [&]() {
+			for (auto node : queue) {
+				NodeTangents tangent_inputs = NodeTangents(node, tangents);
+				if (!tangent_inputs.Any() || node->flags.has(NodeProp::DetachGrad) || node->op->HasAllTypes(OpProp::Nondiff) ||
+				    node->type != TFType::Float) {
+					continue;
+				}
+				if (node->flags.has(NodeProp::Modified) || node->op->HasAnyType(OpProp::Modifier, OpProp::HasChildren)) {
+					throw std::runtime_error("Forward mode autodiff does not support modified values and scoped operations yet: " + node->name);
+				}
+
+				string op_name = node->flags.has(NodeProp::PassGrad) ? "passthrough_grad" : node->name;
+				if (!tangent_functions.contains(op_name)) {
+					throw std::runtime_error("Cannot compute forward gradient for operation " + op_name);
+				}
+
+				Tensor out = *node->tensor_;
+				const Tensor& tangent = tangent_functions[op_name](node->args, out, tangent_inputs);
+				tangents[node] = &tangent;
+				if (GetGradientName(node) != "" && GetGradientName(wrt) != "") {
+					tangent.SetDebugName("d" + GetGradientName(node) + "_d" + GetGradientName(wrt));
+				}
+			}
+			result = tangents.contains(function) ? tangents[function] : &Tensor::Constant(function->GetTensor()->GetShape(), 0.0f);
+		});
+
+		jvp->ReplaceThisWithGivenNode(result->node_);
+		RemoveNode(jvp);
+	}
+
+	UpdateGraph();
+}
+
 void IR::ComputeAutodiff()
 {
-	vector<Node*> gradients = GetNodesOfType(OpProp::Gradient);
+	//forward mode first, so that reverse mode can differentiate through it, and again for forward over reverse
+	ComputeForwardGradients();
+	ComputeBackwardGradients();
+	ComputeForwardGradients();
+
+	vector<Node*> remaining = GetNodesOfType(OpProp::Gradient);
+	if (!remaining.empty()) {
+		throw std::runtime_error("Autodiff: could not compute the gradient " + remaining[0]->var_name);
+	}
+}
+
+void IR::ComputeBackwardGradients()
+{
+	vector<Node*> gradients = GetNodesOfType("backwards_grad");
 
 	if(gradients.empty()) {
 		return;
@@ -342,6 +826,12 @@ void IR::ComputeAutodiff()
 		loss_wrt_grad[{last_loss_version, wrt}] = gradient;
 	}
 
+	//if the user placed checkpoints, everything else is recomputed, otherwise only cheap values are
+	bool has_checkpoints = false;
+	for (auto node = begin(); !node.end(); node.next()) {
+		has_checkpoints |= node->flags.has(NodeProp::Checkpoint);
+	}
+
 	map<Node*, Node*> grad_to_computed_grad;
 	for (auto loss : loss_nodes) {
 		set<Node*> visited;
@@ -370,6 +860,7 @@ void IR::ComputeAutodiff()
 			loss_value = loss->args.Get(ArgType::Memory);
 		}
 
+		Node* backward_end = loss->next;
 		ExecuteExpressionAfter(loss, [&]() {
 			node_to_grad[loss_value] = &Tensor::Constant(1.0f);
 			for(auto node : queue) {
@@ -412,6 +903,10 @@ void IR::ComputeAutodiff()
 			grad_to_computed_grad[grad] = computed_grad;
 		}
 
+		if (rematerialize_forward_values && loss->next != backward_end) {
+			RematerializeForwardValues(loss->next, backward_end, !has_checkpoints);
+		}
+
 		UpdateGraph();
 	}
 
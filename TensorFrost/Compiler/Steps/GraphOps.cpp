@@ -10,8 +10,8 @@ void IR::SeparateOperationsIntoKernels() {
 	for (auto scope : kernel_scopes.first) {
 		// create kernel node before the scope
 		ExecuteExpressionBefore(scope->begin, [&]() {
-			//create kernel node
-			Tensor& tensor = Tensor::Kernel(scope->scope_shape.GetTensors());
+			//create kernel node, without the thread index children Tensor::Kernel adds since its children are replaced below
+			Tensor& tensor = Tensor::Static("kernel", scope->scope_shape.GetTensors(), TFType::None);
 			 Node* kernel_node = tensor.node_;
 			 // make the scope nodes children of the kernel node
 			 kernel_node->child = scope->begin;
@@ -262,6 +262,30 @@ void IR::GetInputList() {
 	}
 }
 
+/// <summary>
+/// Replace the shapes of the inputs with constants, so that they can be folded by the rest of the passes
+/// </summary>
+void IR::SpecializeInputShapes() {
+	vector<Node*> input_shapes = GetNodesOfType("input_shape");
+	for (Node* node : input_shapes) {
+		if (!node->flags.has(NodeProp::InputShapeMemory)) {
+			continue;
+		}
+		int input_index = node->flags.get(NodeProp::InputShapeMemory);
+		int dim = node->flags.get(NodeProp::InputShapeDim);
+		if (!specialized_input_shapes.contains(input_index) || dim >= specialized_input_shapes[input_index].size()) {
+			continue;
+		}
+
+		ExecuteExpressionAfter(node, [&]() {
+			Tensor& value = Tensor::Constant(specialized_input_shapes[input_index][dim]);
+			node->ReplaceThisWithGivenNode(value.node_, -1, false, false);
+		});
+	}
+
+	UpdateGraph();
+}
+
 /// <summary>
 /// Get all outputs of this program in the IR
 /// </summary>
@@ -533,14 +557,28 @@ void IR::AddNodeLoadOperations(Node* node, Node* kernel, Tensors indices) {
 	}
 }
 
-void IR::AddKernelGlobalLoadOperations() {
+//whether the memory is modified inside a loop of the kernel that contains the user
+bool IsModifiedInEnclosingLoop(Node* memory, Node* user, Node* kernel) {
+	for (Node* loop = user->parent; loop != nullptr && loop != kernel; loop = loop->parent) {
+		if (loop->name != "loop") continue;
+		for (auto& [arg, modifier] : memory->args.outputs_) {
+			if (modifier->op->HasAllTypes(OpProp::Modifier) && modifier->HasParent(loop)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void IR::AddKernelGlobalLoadOperations(const unordered_set<Node*>& worklist) {
 	// get kernels
-	vector<Node*> kernels = GetNodesOfType("kernel");
+	vector<Node*> kernels = GetKernels(worklist);
 	for (auto kernel : kernels) {
 
 		// replace all inputs pointing to memory nodes with the memory node
 		unordered_set<Node*> nodes_to_load;
 		unordered_map<Node*, ArgEdges> load_arguments;
+		ArgEdges loads_at_use;
 		for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
 			for (auto& [arg, input_node] : node->args.inputs_) {
 				if (arg.first == ArgType::Memory || arg.first == ArgType::Shape)
@@ -551,12 +589,25 @@ void IR::AddKernelGlobalLoadOperations() {
 				bool is_memory = input_node->op->HasAllTypes(OpProp::Memory);
 
 				if (is_memory || (is_in_a_kernel && is_outside)) {
+					if (IsModifiedInEnclosingLoop(input_node, node.get(), kernel)) {
+						loads_at_use.push_back(ArgEdge(Arg(arg, input_node), node.get()));
+						continue;
+					}
 					nodes_to_load.insert(input_node);
 					load_arguments[input_node].push_back(ArgEdge(Arg(arg, input_node), node.get()));
 				}
 			}
 		}
 
+		for (auto [in, out] : loads_at_use) {
+			// load the memory right before it is used, so that every iteration reads the stored value
+			auto& [arg, from] = in;
+			ExecuteExpressionBefore(out, [&]() {
+				Tensor& loaded = Tensor::Load(*from->GetTensor(), {}, IndexingMode::Unsafe);
+				out->args.UpdateArgument(arg, loaded.node_);
+			});
+		}
+
 		for (auto node : nodes_to_load) {
 			// load the memory node at the beginning of the kernel
 			ExecuteExpressionFirstChild(kernel, [&]() {
@@ -573,9 +624,9 @@ void IR::AddKernelGlobalLoadOperations() {
 }
 
 
-void IR::AddMemoryOpIndices() {
+void IR::AddMemoryOpIndices(const unordered_set<Node*>& worklist) {
 	// get kernels
-	vector<Node*> kernels = GetNodesOfType("kernel");
+	vector<Node*> kernels = GetKernels(worklist);
 	for (auto kernel : kernels) {
 		// get kernel shape arguments
 		NodeArguments shape_args = kernel->args.GetArguments(ArgType::Shape);
@@ -625,6 +676,58 @@ void IR::AddMemoryOpIndices() {
 	UpdateGraph();
 }
 
+/// <summary>
+/// Hash everything the load fusion decisions of a kernel depend on: its size and the loads with their source cost and use count
+/// </summary>
+unordered_map<Node*, size_t> IR::GetKernelLoadSignatures() {
+	ComputeNodeCost();
+
+	unordered_map<Node*, size_t> signatures;
+	for (auto kernel : GetKernels()) {
+		size_t signature = 0;
+		auto combine = [&](size_t value) {
+			HashCombine(signature, value);
+		};
+		for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
+			combine(hash<string>()(node->name));
+			if (node->name != "load") continue;
+			Node* memory_input = node->args.Get(ArgType::Memory);
+			combine(hash<Node*>()(memory_input));
+			combine(memory_input->args.outputs_.size());
+			combine(hash<float>()(memory_input->cost_));
+		}
+		signatures[kernel] = signature;
+	}
+	return signatures;
+}
+
+/// <summary>
+/// Hash the kernel body without node addresses or global indices, so the same kernel gets the same signature in every compilation of a program
+/// </summary>
+size_t IR::GetKernelSignature(Node* kernel) const {
+	unordered_map<Node*, size_t> positions;
+	size_t signature = 0;
+	for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
+		positions[*node] = positions.size();
+		HashCombine(signature, hash<string>()(node->name));
+		HashCombine(signature, (size_t)node->type);
+		for (uint value : node->data) {
+			HashCombine(signature, value);
+		}
+		for (auto& [id, input] : node->args.GetArguments()) {
+			HashCombine(signature, (size_t)id.first);
+			HashCombine(signature, (size_t)id.second);
+			//inputs from outside the kernel are only identified by their operation
+			if (positions.contains(input)) {
+				HashCombine(signature, positions[input]);
+			} else {
+				HashCombine(signature, hash<string>()(input->name));
+			}
+		}
+	}
+	return signature;
+}
+
 void IR::AddKernelGlobalStoreOperations() {
 	// get kernels
 	vector<Node*> kernels = GetNodesOfType("kernel");
@@ -935,6 +1038,18 @@ vector<Tensor*> ComputeIndicesFromBlockIndex(Tensor* block_index, Node* kernel,
 	return indices;
 }
 
+vector<int> GetDefaultGroupSize(int dims) {
+	switch (dims)
+	{
+		case 1:
+			return {256};
+		case 2:
+			return {16, 16};
+		default:
+			return {8, 8, 8};
+	}
+}
+
 Tensor* IR::LinearBlockModeIndices(vector<Tensor*>& indices, Node* kernel_, int dims, Tensors kernel_shape)
 {
 	Tensor* block_index = nullptr;
@@ -942,19 +1057,9 @@ Tensor* IR::LinearBlockModeIndices(vector<Tensor*>& indices, Node* kernel_, int
 	ExecuteExpressionFirstChild(kernel_, [&]() {
 		block_index = &kernel_->GetTensor()->BlockIndex();
 
-		switch (dims)
-		{
-			case 1:
-				kernel_->group_size = {256};
-				break;
-			case 2:
-				kernel_->group_size = {16, 16};
-				break;
-			case 3:
-				kernel_->group_size = {8, 8, 8};
-				break;
-			default:
-				kernel_->group_size = {8, 8, 8};
+		//the group size can be already set by the autotuner
+		if (kernel_->group_size.empty() || kernel_->group_size.size() > dims) {
+			kernel_->group_size = GetDefaultGroupSize(dims);
 		}
 
 		//if the dimensions are known, then use the minimum of the group size and the shape to avoid useless computation
@@ -968,6 +1073,18 @@ Tensor* IR::LinearBlockModeIndices(vector<Tensor*>& indices, Node* kernel_, int
 
 		indices = ComputeIndicesFromBlockIndex(block_index, kernel_, kernel_shape, dims);
 
+		//no need to check if inside the dispatch if the shape is a multiple of the group size
+		bool exact_dispatch = true;
+		for (int i = 0; i < group_dim; i++) {
+			int shape = kernel_shape[dims - group_dim + i]->TryGetConstant();
+			if (shape <= 0 || shape % kernel_->group_size[i] != 0) {
+				exact_dispatch = false;
+			}
+		}
+		if (exact_dispatch) {
+			return;
+		}
+
 		//add a check for if inside the dispatch
 		Tensor* inside_dispatch = &(*indices[0] < *kernel_shape[0]);
 		for (int i = 1; i < dims; i++) {
@@ -1018,7 +1135,16 @@ void IR::FinalizeMemoryIndexing() {
 
 	vector<Tensor*> dispatch_checks;
 
-	for (auto kernel : kernels) {
+	//identical kernels are told apart by how many came before them
+	unordered_map<size_t, int> signature_counts;
+	for (Node* kernel : kernels) {
+		size_t signature = GetKernelSignature(kernel);
+		HashCombine(signature, signature_counts[signature]++);
+		kernel->signature = signature;
+	}
+
+	for (int kernel_index = 0; kernel_index < kernels.size(); kernel_index++) {
+		Node* kernel = kernels[kernel_index];
 		Node* shape_node = kernel;
 		if (shape_node == nullptr) continue;
 		// load kernel shape
@@ -1033,11 +1159,17 @@ void IR::FinalizeMemoryIndexing() {
 			continue;
 		}
 
+		if (group_size_overrides.contains(kernel->signature)) {
+			kernel->group_size = group_size_overrides[kernel->signature];
+		}
+
 		// compute the index for each dimension
 		int dims = (int)kernel_shape.size();
 		vector<Tensor*> indices = vector<Tensor*>(dims);
-		dispatch_checks.push_back(
-		    LinearBlockModeIndices(indices, kernel, dims, kernel_shape));
+		Tensor* dispatch_check = LinearBlockModeIndices(indices, kernel, dims, kernel_shape);
+		if (dispatch_check != nullptr) {
+			dispatch_checks.push_back(dispatch_check);
+		}
 
 		// go over all nodes that take an index as input (e.g. load, store, atomic)
 		for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
@@ -166,6 +166,684 @@ void IR::OptimizeOperations()
 	}
 }
 
+bool IsPureOperation(Node* node, bool allow_algorithms) {
+	const Operation* op = node->op;
+	if (op->HasAnyType(OpProp::Static, OpProp::HasChildren, OpProp::Memory, OpProp::MemoryOp, OpProp::Modifier,
+	                   OpProp::CantSubstitute, OpProp::Gradient, OpProp::Debug)) {
+		return false;
+	}
+	if (!allow_algorithms && op->HasAllTypes(OpProp::Algorithm)) {
+		return false;
+	}
+	if (op->class_ == OpClass::Keyword || op->class_ == OpClass::Variable) {
+		return false;
+	}
+	//variables that are modified (and everything that reads them) can have a different value at each point
+	if (node->flags.has(NodeProp::Modified) || node->flags.has(NodeProp::InputMemory) || node->flags.has(NodeProp::OutputMemory)) {
+		return false;
+	}
+	for (auto& [id, from] : node->args.inputs_) {
+		if (from->flags.has(NodeProp::Modified)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsCommutative(const string& name) {
+	static const unordered_set<string> commutative_ops = {
+	    "add", "mul", "min", "max", "and", "or", "xor", "eq", "neq",
+	};
+	return commutative_ops.contains(name);
+}
+
+//everything that defines the value of a pure node
+vector<size_t> GetNodeValueKey(Node* node) {
+	vector<size_t> key = {hash<string>()(node->name), (size_t)node->type, (size_t)node->indexing_mode_, node->data.size()};
+	for (uint value : node->data) {
+		key.push_back(value);
+	}
+	vector<tuple<size_t, size_t, size_t>> args;
+	for (auto& [id, from] : node->args.inputs_) {
+		args.push_back({(size_t)id.first, (size_t)id.second, (size_t)from});
+	}
+	if (IsCommutative(node->name) && node->args.Count(ArgType::Input) == 2) {
+		//order the two inputs by pointer so that a+b and b+a get the same key
+		vector<size_t> inputs = {(size_t)node->args.Get(ArgType::Input, 0), (size_t)node->args.Get(ArgType::Input, 1)};
+		sort(inputs.begin(), inputs.end());
+		for (auto& [type, index, from] : args) {
+			if (type == (size_t)ArgType::Input) {
+				from = inputs[index];
+			}
+		}
+	}
+	for (auto& [type, index, from] : args) {
+		key.push_back(type);
+		key.push_back(index);
+		key.push_back(from);
+	}
+	return key;
+}
+
+struct NodeKeyHash {
+	size_t operator()(const vector<size_t>& key) const {
+		size_t result = key.size();
+		for (size_t value : key) {
+			HashCombine(result, value);
+		}
+		return result;
+	}
+};
+
+using ValueTable = unordered_map<vector<size_t>, Node*, NodeKeyHash>;
+
+//a node can only be replaced by an equal node from the same or an enclosing scope that comes before it
+void EliminateCommonSubexpressionsInScope(Node* parent, vector<ValueTable>& scopes, vector<Node*>& eliminated) {
+	for (Node* node = parent->child; node->valid(); node = node->next) {
+		if (node->op->HasAllTypes(OpProp::HasChildren)) {
+			if (node->name == "kernel") {
+				//kernels can not use values computed in other kernels
+				vector<ValueTable> kernel_scopes(1);
+				EliminateCommonSubexpressionsInScope(node, kernel_scopes, eliminated);
+			} else {
+				scopes.emplace_back();
+				EliminateCommonSubexpressionsInScope(node, scopes, eliminated);
+				scopes.pop_back();
+			}
+			continue;
+		}
+
+		if (!IsPureOperation(node)) {
+			continue;
+		}
+
+		vector<size_t> key = GetNodeValueKey(node);
+		Node* existing = nullptr;
+		for (int i = (int)scopes.size() - 1; i >= 0 && existing == nullptr; i--) {
+			auto it = scopes[i].find(key);
+			if (it != scopes[i].end()) {
+				existing = it->second;
+			}
+		}
+
+		if (existing != nullptr) {
+			node->ReplaceThisWithGivenNode(existing, -1, false, false);
+			eliminated.push_back(node);
+		} else {
+			scopes.back()[key] = node;
+		}
+	}
+}
+
+void IR::EliminateCommonSubexpressions() {
+	UpdateGraph();
+	vector<ValueTable> scopes(1);
+	vector<Node*> eliminated;
+	EliminateCommonSubexpressionsInScope(root, scopes, eliminated);
+
+	for (Node* node : eliminated) {
+		RemoveNode(node);
+	}
+
+	UpdateGraph();
+}
+
+bool IsLoopInvariant(Node* node, Node* loop) {
+	for (auto& [id, from] : node->args.inputs_) {
+		if (from == loop || from->HasParent(loop)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//can be executed even if the loop has zero iterations
+bool CanHoistOperation(Node* node, const unordered_set<Node*>& modified_memory) {
+	if (node->name == "load") {
+		//unsafe loads are only known to be in bounds when the loop body executes, unless proven otherwise
+		Node* memory = node->args.Get(ArgType::Memory);
+		bool in_bounds = node->indexing_mode_ != IndexingMode::Unsafe || node->flags.has(NodeProp::InBounds);
+		if (!in_bounds || modified_memory.contains(memory) || node->flags.has(NodeProp::Modified)) {
+			return false;
+		}
+		//an index variable that is set inside the loop has a different value at each iteration
+		for (auto& [id, from] : node->args.inputs_) {
+			if (from->flags.has(NodeProp::Modified)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	if (!IsPureOperation(node)) {
+		return false;
+	}
+	if ((node->name == "div" || node->name == "mod") && node->type != TFType::Float) {
+		//integer division by zero traps on the CPU
+		Node* divisor = node->args.Get(ArgType::Input, 1);
+		return divisor->name == "const" && !divisor->flags.has(NodeProp::Modified) && divisor->data[0] != 0;
+	}
+	return true;
+}
+
+/// <summary>
+/// Move loop invariant pure operations and loads from memory that is not modified in the kernel before the loop
+/// </summary>
+void IR::MoveLoopInvariants() {
+	UpdateGraph();
+	vector<Node*> loops = GetNodesOfType("loop");
+	//inner loops first, so that their invariants can be moved further out
+	reverse(loops.begin(), loops.end());
+
+	unordered_map<Node*, unordered_set<Node*>> kernel_modified_memory;
+	for (Node* kernel : GetNodesOfType("kernel")) {
+		for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
+			if (node->op->HasAllTypes(OpProp::Modifier, OpProp::MemoryOp)) {
+				kernel_modified_memory[kernel].insert(node->args.Get(ArgType::Memory));
+			}
+		}
+	}
+
+	for (Node* loop : loops) {
+		Node* kernel = loop->GetParent("kernel");
+		if (kernel == loop) {
+			continue; //only loops inside kernels
+		}
+
+		Node* next = nullptr;
+		for (Node* node = loop->child; node->valid(); node = next) {
+			next = node->next;
+			if (CanHoistOperation(node, kernel_modified_memory[kernel]) && IsLoopInvariant(node, loop)) {
+				MoveNodeTo(loop, node);
+			}
+		}
+	}
+
+	UpdateGraph();
+}
+
+bool HasKeyword(Node* parent, const string& keyword) {
+	for (auto node = NodeIterator(parent); !node.end(); node.next()) {
+		if (node->name == keyword) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//check if the integer node is an affine function of the loop index with invariant coefficients
+bool IsAffineInLoop(Node* node, Node* loop, bool& has_multiply) {
+	if (node == loop) {
+		return true;
+	}
+	if (!node->HasParent(loop)) {
+		return !node->flags.has(NodeProp::Modified);
+	}
+	if (node->type != TFType::Int || node->parent != loop || !IsPureOperation(node)) {
+		return false;
+	}
+	if (node->name == "add" || node->name == "sub") {
+		return IsAffineInLoop(node->args.Get(ArgType::Input, 0), loop, has_multiply) &&
+		       IsAffineInLoop(node->args.Get(ArgType::Input, 1), loop, has_multiply);
+	}
+	if (node->name == "mul") {
+		Node* a = node->args.Get(ArgType::Input, 0);
+		Node* b = node->args.Get(ArgType::Input, 1);
+		bool a_invariant = a != loop && !a->HasParent(loop);
+		bool b_invariant = b != loop && !b->HasParent(loop);
+		has_multiply = true;
+		return (a_invariant && IsAffineInLoop(b, loop, has_multiply)) || (b_invariant && IsAffineInLoop(a, loop, has_multiply));
+	}
+	return false;
+}
+
+//build the value at the first iteration and the increment per unit of the loop index (nullptr if zero)
+pair<const Tensor*, const Tensor*> BuildAffineForm(Node* node, Node* loop) {
+	if (node == loop) {
+		return {loop->args.Get(ArgType::Input, 0)->GetTensor(), &Tensor::Constant(1)};
+	}
+	if (!node->HasParent(loop)) {
+		return {node->GetTensor(), nullptr};
+	}
+	auto [base_a, stride_a] = BuildAffineForm(node->args.Get(ArgType::Input, 0), loop);
+	auto [base_b, stride_b] = BuildAffineForm(node->args.Get(ArgType::Input, 1), loop);
+	if (node->name == "add") {
+		const Tensor* stride = stride_a == nullptr ? stride_b : (stride_b == nullptr ? stride_a : &(*stride_a + *stride_b));
+		return {&(*base_a + *base_b), stride};
+	}
+	if (node->name == "sub") {
+		const Tensor* stride = stride_b == nullptr ? stride_a : (stride_a == nullptr ? &(-*stride_b) : &(*stride_a - *stride_b));
+		return {&(*base_a - *base_b), stride};
+	}
+	//mul, one of the sides is invariant
+	const Tensor* stride = nullptr;
+	if (stride_a != nullptr) {
+		stride = &(*stride_a * *base_b);
+	} else if (stride_b != nullptr) {
+		stride = &(*base_a * *stride_b);
+	}
+	return {&(*base_a * *base_b), stride};
+}
+
+/// <summary>
+/// Replace affine functions of the loop index with induction variables that are incremented every iteration
+/// </summary>
+void IR::StrengthReduceLoopIndices() {
+	UpdateGraph();
+	vector<Node*> loops = GetNodesOfType("loop");
+
+	for (Node* loop : loops) {
+		if (loop->GetParent("kernel") == loop || HasKeyword(loop, "continue")) {
+			continue;
+		}
+
+		//find the outermost affine nodes that are used by something that is not affine
+		vector<Node*> candidates;
+		for (Node* node = loop->child; node->valid(); node = node->next) {
+			bool has_multiply = false;
+			if (node->type != TFType::Int || !IsAffineInLoop(node, loop, has_multiply) || !has_multiply) {
+				continue;
+			}
+			bool used_by_non_affine = false;
+			for (auto& [edge, to] : node->args.outputs_) {
+				bool to_multiply = false;
+				if (to->parent != loop || !IsAffineInLoop(to, loop, to_multiply)) {
+					used_by_non_affine = true;
+				}
+			}
+			if (used_by_non_affine) {
+				candidates.push_back(node);
+			}
+		}
+
+		//build all the induction variables before replacing anything, the affine forms use the original nodes
+		vector<pair<Tensor*, const Tensor*>> inductions;
+		ExecuteExpressionBefore(loop, [&]() {
+			for (Node* node : candidates) {
+				auto [base, stride] = BuildAffineForm(node, loop);
+				Tensor* induction = &Tensor::copy(*base);
+				induction->SetDebugName("induction");
+				const Tensor* increment = stride == nullptr ? nullptr : &(*stride * *loop->args.Get(ArgType::Input, 2)->GetTensor());
+				inductions.push_back({induction, increment});
+			}
+		});
+
+		for (int i = 0; i < candidates.size(); i++) {
+			auto [induction, increment] = inductions[i];
+			candidates[i]->ReplaceThisWithGivenNode(induction->node_, -1, false, false);
+			if (increment == nullptr) {
+				continue;
+			}
+			ExecuteExpressionLastChild(loop, [&]() {
+				induction->Set(*induction + *increment);
+			});
+		}
+	}
+
+	UpdateGraph();
+}
+
+//x >= lower and x <= bound + offset for every upper bound (constant bound if the node is nullptr)
+struct IndexRange {
+	bool has_lower = false;
+	int64_t lower = 0;
+	vector<pair<Node*, int64_t>> upper;
+
+	void AddUpper(Node* bound, int64_t offset) {
+		upper.push_back({bound, offset});
+	}
+
+	bool HasConstantUpper(int64_t& value) const {
+		bool found = false;
+		for (auto& [bound, offset] : upper) {
+			if (bound == nullptr && (!found || offset < value)) {
+				value = offset;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	IndexRange Shifted(int64_t shift) const {
+		IndexRange result = *this;
+		result.lower += shift;
+		for (auto& [bound, offset] : result.upper) {
+			offset += shift;
+		}
+		return result;
+	}
+};
+
+bool IsIntegerConstant(Node* node, int64_t& value) {
+	if (node->name != "const" || node->flags.has(NodeProp::Modified) || node->type == TFType::Float) {
+		return false;
+	}
+	value = node->type == TFType::Uint ? (int64_t)node->data[0] : (int64_t)AsInt(node->data[0]);
+	return true;
+}
+
+#define MAX_RANGE_DEPTH 16
+
+//check if two nodes always have the same value
+bool IsSameValue(Node* a, Node* b, int depth = 0) {
+	if (a == b) {
+		return true;
+	}
+	if (depth > MAX_RANGE_DEPTH || a->name != b->name || a->type != b->type || a->data != b->data) {
+		return false;
+	}
+	int64_t va, vb;
+	if (IsIntegerConstant(a, va) && IsIntegerConstant(b, vb)) {
+		return va == vb;
+	}
+	if (a->name == "input_shape") {
+		return a->flags.has(NodeProp::InputShapeMemory) && b->flags.has(NodeProp::InputShapeMemory) &&
+		       a->flags.get(NodeProp::InputShapeMemory) == b->flags.get(NodeProp::InputShapeMemory) &&
+		       a->flags.get(NodeProp::InputShapeDim) == b->flags.get(NodeProp::InputShapeDim);
+	}
+	if (!IsPureOperation(a) || !IsPureOperation(b) || a->args.inputs_.size() != b->args.inputs_.size()) {
+		return false;
+	}
+	for (auto& [id, from] : a->args.inputs_) {
+		auto other = b->args.inputs_.find(id);
+		if (other == b->args.inputs_.end() || !IsSameValue(from, other->second, depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+IndexRange ComputeIndexRange(Node* node, unordered_map<Node*, IndexRange>& ranges, int depth = 0) {
+	if (ranges.contains(node)) {
+		return ranges[node];
+	}
+
+	IndexRange range;
+	int64_t value;
+	auto input = [&](int index) {
+		return ComputeIndexRange(node->args.Get(ArgType::Input, index), ranges, depth + 1);
+	};
+
+	if (depth > MAX_RANGE_DEPTH || node->flags.has(NodeProp::Modified)) {
+		//unknown
+	} else if (IsIntegerConstant(node, value)) {
+		range.has_lower = true;
+		range.lower = value;
+		range.AddUpper(nullptr, value);
+	} else if (node->name == "input_shape") {
+		//input shapes are checked to be positive
+		range.has_lower = true;
+		range.lower = 1;
+	} else if (node->name == "dim_id" && node->GetParent("kernel") != node) {
+		//dim nodes are replaced with the kernel indices, threads outside of the kernel shape are discarded
+		Node* kernel = node->GetParent("kernel");
+		int dim = (int)node->data[0];
+		range.has_lower = true;
+		range.lower = 0;
+		if (dim >= kernel->args.Count(ArgType::Shape)) {
+			range.AddUpper(nullptr, 0);
+		} else {
+			Node* shape = kernel->args.Get(ArgType::Shape, dim);
+			range.AddUpper(shape, -1);
+			if (IsIntegerConstant(shape, value)) {
+				range.AddUpper(nullptr, value - 1);
+			}
+		}
+	} else if (node->name == "block_id" || node->name == "block_thread_id") {
+		range.has_lower = true;
+		range.lower = 0;
+	} else if (node->name == "loop") {
+		int64_t step;
+		if (IsIntegerConstant(node->args.Get(ArgType::Input, 2), step) && step > 0) {
+			IndexRange begin = input(0);
+			IndexRange end = input(1);
+			range.has_lower = begin.has_lower;
+			range.lower = begin.lower;
+			range.AddUpper(node->args.Get(ArgType::Input, 1), -1);
+			for (auto& [bound, offset] : end.upper) {
+				range.AddUpper(bound, offset - 1);
+			}
+		}
+	} else if (node->name == "copy") {
+		range = input(0);
+	} else if (node->name == "add" || node->name == "sub") {
+		IndexRange a = input(0);
+		IndexRange b = input(1);
+		bool is_add = node->name == "add";
+		int64_t b_upper;
+		if (IsIntegerConstant(node->args.Get(ArgType::Input, 1), value)) {
+			range = a.Shifted(is_add ? value : -value);
+		} else if (is_add && IsIntegerConstant(node->args.Get(ArgType::Input, 0), value)) {
+			range = b.Shifted(value);
+		} else if (is_add) {
+			range.has_lower = a.has_lower && b.has_lower;
+			range.lower = a.lower + b.lower;
+			if (b.HasConstantUpper(b_upper)) {
+				for (auto& [bound, offset] : a.upper) range.AddUpper(bound, offset + b_upper);
+			}
+			int64_t a_upper;
+			if (a.HasConstantUpper(a_upper)) {
+				for (auto& [bound, offset] : b.upper) range.AddUpper(bound, offset + a_upper);
+			}
+		} else {
+			range.has_lower = a.has_lower && b.HasConstantUpper(b_upper);
+			range.lower = range.has_lower ? a.lower - b_upper : 0;
+			if (b.has_lower) {
+				for (auto& [bound, offset] : a.upper) range.AddUpper(bound, offset - b.lower);
+			}
+		}
+	} else if (node->name == "min") {
+		IndexRange a = input(0);
+		IndexRange b = input(1);
+		range.has_lower = a.has_lower && b.has_lower;
+		range.lower = std::min(a.lower, b.lower);
+		range.upper = a.upper;
+		range.upper.insert(range.upper.end(), b.upper.begin(), b.upper.end());
+	} else if (node->name == "max") {
+		IndexRange a = input(0);
+		IndexRange b = input(1);
+		range.has_lower = a.has_lower || b.has_lower;
+		range.lower = a.has_lower && b.has_lower ? std::max(a.lower, b.lower) : (a.has_lower ? a.lower : b.lower);
+		int64_t a_upper, b_upper;
+		if (a.HasConstantUpper(a_upper) && b.HasConstantUpper(b_upper)) {
+			range.AddUpper(nullptr, std::max(a_upper, b_upper));
+		}
+	} else if (node->name == "clamp") {
+		IndexRange low = input(1);
+		IndexRange high = input(2);
+		range.has_lower = low.has_lower;
+		range.lower = low.lower;
+		range.upper = high.upper;
+		range.AddUpper(node->args.Get(ArgType::Input, 2), 0);
+	} else if (node->name == "mod") {
+		IndexRange a = input(0);
+		IndexRange b = input(1);
+		if (a.has_lower && a.lower >= 0 && b.has_lower && b.lower >= 1) {
+			range.has_lower = true;
+			range.lower = 0;
+			range.AddUpper(node->args.Get(ArgType::Input, 1), -1);
+			for (auto& [bound, offset] : b.upper) range.AddUpper(bound, offset - 1);
+			range.upper.insert(range.upper.end(), a.upper.begin(), a.upper.end());
+		}
+	} else if (node->name == "div" && IsIntegerConstant(node->args.Get(ArgType::Input, 1), value) && value > 0) {
+		IndexRange a = input(0);
+		int64_t a_upper;
+		if (a.has_lower && a.lower >= 0) {
+			range.has_lower = true;
+			range.lower = a.lower / value;
+			if (a.HasConstantUpper(a_upper)) {
+				range.AddUpper(nullptr, a_upper / value);
+			}
+		}
+	} else if (node->name == "and" && node->type != TFType::Bool) {
+		if (IsIntegerConstant(node->args.Get(ArgType::Input, 1), value) && value >= 0) {
+			range.has_lower = true;
+			range.lower = 0;
+			range.AddUpper(nullptr, value);
+		}
+	}
+
+	//every value is bounded by itself
+	range.AddUpper(node, 0);
+	ranges[node] = range;
+	return range;
+}
+
+bool IsIndexInBounds(Node* index, Node* size, unordered_map<Node*, IndexRange>& ranges) {
+	IndexRange range = ComputeIndexRange(index, ranges);
+	if (!range.has_lower || range.lower < 0) {
+		return false;
+	}
+	int64_t size_value;
+	bool constant_size = IsIntegerConstant(size, size_value);
+	for (auto& [bound, offset] : range.upper) {
+		if (bound == nullptr) {
+			if (constant_size && offset <= size_value - 1) {
+				return true;
+			}
+		} else if (offset <= -1 && IsSameValue(bound, size)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Use unsafe indexing for memory accesses that are proven to be in bounds, so that no clamping is needed
+/// </summary>
+void IR::OptimizeIndexingModes() {
+	UpdateGraph();
+	unordered_map<Node*, IndexRange> ranges;
+	for (auto node = begin(); !node.end(); node.next()) {
+		if (!node->op->HasAllTypes(OpProp::MemoryOp) || node->indexing_mode_ == IndexingMode::Unsafe) {
+			continue;
+		}
+		map<int, const Tensor*> indices = node->args.GetTensors(ArgType::Index);
+		if (indices.empty()) {
+			continue;
+		}
+
+		const Tensor* memory = node->args.GetTensor(ArgType::Memory);
+		NodeArguments memory_shape = memory->node_->args.GetArguments(ArgType::Shape);
+		if (indices.size() != memory_shape.size()) {
+			continue;
+		}
+
+		bool in_bounds = true;
+		for (auto& [dim, index] : indices) {
+			Node* size = memory_shape[ArgID(ArgType::Shape, dim)];
+			if (size == nullptr || !IsIndexInBounds(index->node_, size, ranges)) {
+				in_bounds = false;
+				break;
+			}
+		}
+
+		if (in_bounds) {
+			node->indexing_mode_ = IndexingMode::Unsafe;
+			node->flags.set(NodeProp::InBounds);
+		}
+	}
+}
+
+//the value does not change between the threads of the kernel
+bool IsKernelInvariant(Node* node, Node* kernel, int depth = 0) {
+	if (!node->HasParent(kernel)) {
+		return !node->op->HasAnyType(OpProp::Memory) && !node->flags.has(NodeProp::Modified);
+	}
+	if (depth > MAX_RANGE_DEPTH || !IsPureOperation(node) || node->op->class_ == OpClass::DimensionIndex) {
+		return false;
+	}
+	for (auto& [id, from] : node->args.inputs_) {
+		if (id.first == ArgType::Input && !IsKernelInvariant(from, kernel, depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//recompute a kernel invariant value on the host, must be called before the kernel
+Node* CopyInvariantToHost(Node* node, Node* kernel, unordered_map<Node*, Node*>& copies) {
+	if (!node->HasParent(kernel)) {
+		return node;
+	}
+	if (copies.contains(node)) {
+		return copies[node];
+	}
+	NodeArguments new_args;
+	for (auto& [id, from] : node->args.inputs_) {
+		if (id.first == ArgType::Input) {
+			new_args[id] = CopyInvariantToHost(from, kernel, copies);
+		}
+	}
+	Node* copy = Tensor::GetCopy(*node->GetTensor(), new_args)->node_;
+	copies[node] = copy;
+	return copy;
+}
+
+/// <summary>
+/// Replace integer division and modulo by kernel invariant non-constant divisors (like the dispatch shape)
+/// with a multiply-high and shift, the magic numbers are computed once on the host and passed as kernel variables
+/// </summary>
+void IR::OptimizeInvariantDivisions() {
+	UpdateGraph();
+	unordered_map<Node*, IndexRange> ranges;
+	vector<Node*> replaced;
+	for (Node* kernel : GetNodesOfType("kernel")) {
+		unordered_map<Node*, Node*> host_copies;
+		unordered_map<Node*, pair<const Tensor*, const Tensor*>> magic_numbers;
+		for (auto node = NodeIterator(kernel); !node.end(); node.next()) {
+			if ((node->name != "div" && node->name != "mod") || node->type == TFType::Float) {
+				continue;
+			}
+			Node* dividend = node->args.Get(ArgType::Input, 0);
+			Node* divisor = node->args.Get(ArgType::Input, 1);
+			int64_t value;
+			//division by a constant is already optimized by the shader/C++ compiler
+			if (IsIntegerConstant(divisor, value) || !IsKernelInvariant(divisor, kernel)) {
+				continue;
+			}
+			//only valid for unsigned division by a positive number
+			IndexRange divisor_range = ComputeIndexRange(divisor, ranges);
+			IndexRange dividend_range = ComputeIndexRange(dividend, ranges);
+			bool positive_divisor = divisor_range.has_lower && divisor_range.lower >= 1;
+			bool unsigned_dividend = node->type == TFType::Uint || (dividend_range.has_lower && dividend_range.lower >= 0);
+			if (!positive_divisor || !unsigned_dividend) {
+				continue;
+			}
+
+			if (!magic_numbers.contains(divisor)) {
+				ExecuteExpressionBefore(kernel, [&]() {
+					Node* host_divisor = CopyInvariantToHost(divisor, kernel, host_copies);
+					const Tensor* udivisor = host_divisor->GetTensor();
+					if (host_divisor->type != TFType::Uint) {
+						udivisor = &Tensor::touint(*udivisor);
+					}
+					magic_numbers[divisor] = {&Tensor::fastdiv_multiplier(*udivisor), &Tensor::fastdiv_shift(*udivisor)};
+				});
+			}
+
+			auto [multiplier, shift] = magic_numbers[divisor];
+			Tensor* result = nullptr;
+			ExecuteExpressionBefore(node.get(), [&]() {
+				const Tensor* x = dividend->GetTensor();
+				const Tensor* udividend = dividend->type == TFType::Uint ? x : &Tensor::touint(*x);
+				Tensor* quotient = &Tensor::fastdiv(*udividend, *multiplier, *shift);
+				if (node->type != TFType::Uint) {
+					quotient = &Tensor::toint(*quotient);
+				}
+				result = node->name == "div" ? quotient : &(*x - *quotient * *divisor->GetTensor());
+			});
+			node->ReplaceThisWithGivenNode(result->node_, -1, false, false);
+			replaced.push_back(node.get());
+		}
+	}
+
+	for (Node* node : replaced) {
+		RemoveNode(node);
+	}
+
+	UpdateGraph();
+}
+
 void IR::RemoveUnusedOperations() {
 	unordered_set<Node*> used_nodes;
 	//mark all output nodes as used
@@ -229,6 +907,176 @@ void IR::RemoveUnusedKernels()
 	UpdateGraph();
 }
 
+bool HaveSameShape(Node* a, Node* b) {
+	int dims = a->args.Count(ArgType::Shape);
+	if (dims != b->args.Count(ArgType::Shape)) {
+		return false;
+	}
+	for (int i = 0; i < dims; i++) {
+		if (!IsSameValue(a->args.Get(ArgType::Shape, i), b->args.Get(ArgType::Shape, i))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//get all memory nodes accessed by the node and its children, and which of them are written to
+void GetMemoryAccesses(Node* node, unordered_set<Node*>& accessed, unordered_set<Node*>& written) {
+	auto add_access = [&](Node* n) {
+		for (auto& [id, from] : n->args.inputs_) {
+			if (!from->op->HasAllTypes(OpProp::Memory)) {
+				continue;
+			}
+			accessed.insert(from);
+			//anything but a load could change the memory (reshape, deallocate, etc.)
+			if (n->name != "load" && id.first != ArgType::Shape) {
+				written.insert(from);
+			}
+		}
+	};
+	add_access(node);
+	for (auto child = NodeIterator(node); !child.end(); child.next()) {
+		add_access(child.get());
+	}
+}
+
+bool HasMemoryConflict(const unordered_set<Node*>& accessed_a, const unordered_set<Node*>& written_a,
+                       const unordered_set<Node*>& accessed_b, const unordered_set<Node*>& written_b) {
+	for (Node* memory : written_a) {
+		if (accessed_b.contains(memory)) return true;
+	}
+	for (Node* memory : written_b) {
+		if (accessed_a.contains(memory)) return true;
+	}
+	return false;
+}
+
+//find the nodes between the kernels that the second kernel needs, returns false if they can not be moved before the first kernel
+bool GetNodesToMoveBefore(Node* first, Node* second, vector<Node*>& to_move) {
+	unordered_set<Node*> movable;
+	for (Node* node = first->next; node != second; node = node->next) {
+		bool is_allocation = node->name == "memory" && !node->flags.has(NodeProp::InputMemory);
+		if (!is_allocation && !IsPureOperation(node)) {
+			continue;
+		}
+		bool inputs_before = true;
+		for (auto& [id, from] : node->args.inputs_) {
+			if (from->index_ >= first->index_ && !movable.contains(from)) {
+				inputs_before = false;
+			}
+		}
+		if (inputs_before) {
+			movable.insert(node);
+		}
+	}
+
+	unordered_set<Node*> needed;
+	auto require = [&](Node* from) {
+		if (from->index_ < first->index_ || from->HasParent(second) || from == second) {
+			return true;
+		}
+		if (!movable.contains(from)) {
+			return false;
+		}
+		needed.insert(from);
+		return true;
+	};
+	for (auto& [id, from] : second->args.inputs_) {
+		if (!require(from)) return false;
+	}
+	for (auto node = NodeIterator(second); !node.end(); node.next()) {
+		for (auto& [id, from] : node->args.inputs_) {
+			if (!require(from)) return false;
+		}
+	}
+	//the movable nodes can depend on other movable nodes
+	for (Node* node = second->prev; node != first; node = node->prev) {
+		if (needed.contains(node)) {
+			for (auto& [id, from] : node->args.inputs_) {
+				if (movable.contains(from)) needed.insert(from);
+			}
+		}
+	}
+	for (Node* node = first->next; node != second; node = node->next) {
+		if (needed.contains(node)) to_move.push_back(node);
+	}
+	return true;
+}
+
+/// <summary>
+/// Merge independent kernels with the same shape into a single dispatch (horizontal fusion)
+/// </summary>
+void IR::FuseIndependentKernels() {
+	UpdateGraph();
+	vector<Node*> kernels = GetNodesOfType("kernel");
+	unordered_set<Node*> fused;
+
+	for (Node* kernel : kernels) {
+		if (fused.contains(kernel)) {
+			continue;
+		}
+		unordered_set<Node*> accessed, written;
+		GetMemoryAccesses(kernel, accessed, written);
+
+		//look for kernels further down in the same scope
+		for (Node* node = kernel->next; node->valid(); node = node->next) {
+			if (node->op->HasAllTypes(OpProp::HasChildren) && node->name != "kernel") {
+				break;
+			}
+			if (node->name != "kernel") {
+				continue;
+			}
+
+			unordered_set<Node*> node_accessed, node_written;
+			GetMemoryAccesses(node, node_accessed, node_written);
+
+			vector<Node*> to_move;
+			bool can_fuse = HaveSameShape(kernel, node) && !HasMemoryConflict(accessed, written, node_accessed, node_written) &&
+			                GetNodesToMoveBefore(kernel, node, to_move);
+
+			//the kernel executes earlier, nothing in between can touch its memory
+			if (can_fuse) {
+				unordered_set<Node*> moved(to_move.begin(), to_move.end());
+				for (Node* between = kernel->next; between != node && can_fuse; between = between->next) {
+					if (moved.contains(between)) continue;
+					unordered_set<Node*> between_accessed, between_written;
+					GetMemoryAccesses(between, between_accessed, between_written);
+					can_fuse = !HasMemoryConflict(between_accessed, between_written, node_accessed, node_written);
+				}
+			}
+
+			if (!can_fuse) {
+				continue;
+			}
+
+			for (Node* move : to_move) {
+				MoveNodeTo(kernel, move);
+			}
+
+			//append the children of the second kernel to the end of the first one
+			Node* kernel_end = kernel->child;
+			while (kernel_end->valid()) kernel_end = kernel_end->next;
+			vector<Node*> children;
+			for (Node* child = node->child; child->valid(); child = child->next) {
+				children.push_back(child);
+			}
+			for (Node* child : children) {
+				MoveNodeTo(kernel_end, child);
+			}
+
+			accessed.insert(node_accessed.begin(), node_accessed.end());
+			written.insert(node_written.begin(), node_written.end());
+			fused.insert(node);
+			Node* empty_kernel = node;
+			node = node->prev;
+			RemoveNode(empty_kernel);
+			UpdateGraph();
+		}
+	}
+
+	UpdateGraph();
+}
+
 #define MAX_UNROLL_NODES 128
 void IR::UnrollLoops(int max_iterations)
 {
@@ -787,10 +1635,10 @@ void IR::OptimizeKernels() {
 #define MAX_LOAD_COPY 3000.0f
 #define MAX_LOAD_COPY_COUNT 2
 #define MAX_LOAD_SIZE_RATIO 0.5f
-void IR::OptimizeKernelLoadOperations() {
+void IR::OptimizeKernelLoadOperations(const unordered_set<Node*>& worklist) {
 	ComputeNodeCost();
 
-	vector<Node*> kernels = GetNodesOfType("kernel");
+	vector<Node*> kernels = GetKernels(worklist);
 
 	unordered_set<Node*> nodes_to_remove;
 
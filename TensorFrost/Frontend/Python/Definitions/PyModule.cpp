@@ -1,10 +1,196 @@
 #include <utility>
 #include <vector>
 
+#include <Frontend/Python/PyTensor.h>
 #include <Frontend/Python/PyModule.h>
 
 namespace TensorFrost {
 
+//index of every element of a tensor with the given shape in a packed buffer
+static const Tensor& PackedIndex(const Tensors& shape, int offset) {
+    if (shape.empty()) {
+        return Tensor::Constant(offset);
+    }
+    const Tensor* index = &Tensor::Index(shape, 0);
+    for (int d = 1; d < (int)shape.size(); d++) {
+        index = &(*index * *shape[d] + Tensor::Index(shape, d));
+    }
+    return *index + Tensor::Constant(offset);
+}
+
+static Tensors ConstantShape(const vector<int>& shape) {
+    Tensors result;
+    for (int dim : shape) {
+        result.push_back(&Tensor::Constant(dim));
+    }
+    return result;
+}
+
+static py::object& FlatParameterValue(Module::FlatParameter& entry) {
+    py::object& value = entry.module->_attributes[entry.name];
+    if (entry.array_index < 0) {
+        return value;
+    }
+    return py::cast<ParameterArray&>(value)._parameters[entry.array_index];
+}
+
+void Module::build_flat_layout() {
+    if (!_flat_layout.empty()) {
+        return;
+    }
+
+    _flat_size = 0;
+    auto add_param = [&](Module& module, const string& name, int array_index, py::object value, bool requires_grad) {
+        if (!py::isinstance<Parameter>(value)) {
+            throw std::runtime_error("Flat parameter storage must be set up before the parameters are initialized");
+        }
+        Parameter& param = py::cast<Parameter&>(value);
+        if (param.dtype != TFType::Float) {
+            throw std::runtime_error("Flat parameter storage only supports float parameters, " + name + " is not");
+        }
+        int size = 1;
+        for (int dim : param.shape) {
+            if (dim <= 0) {
+                throw std::runtime_error("Flat parameter storage requires parameters with known shapes, " + name + " has an unknown dimension");
+            }
+            size *= dim;
+        }
+        _flat_layout.push_back({&module, name, array_index, param, requires_grad, _flat_size, size});
+        _flat_size += size;
+    };
+
+    //same order as the parameters of a regular module
+    std::function<void(Module&, bool)> add_module;
+    add_module = [&](Module& module, bool module_requires_grad) {
+        module._flat_root = this;
+        for (auto& module_item : module.get_attributes_of_type(AttributeType::Module)) {
+            add_module(py::cast<Module&>(module_item.second), module_requires_grad && module.param_requires_grad(module_item.first));
+        }
+
+        for (auto& param : module.get_attributes_of_type(AttributeType::Parameter)) {
+            add_param(module, param.first, -1, param.second, module_requires_grad && module.param_requires_grad(param.first));
+        }
+
+        for (auto& array : module.get_attributes_of_type(AttributeType::ParameterArray)) {
+            ParameterArray& param_array = py::cast<ParameterArray&>(array.second);
+            param_array._flat_root = this;
+            bool requires_grad = module_requires_grad && module.param_requires_grad(array.first);
+            for (auto& param : param_array._parameters) {
+                add_param(module, array.first, (int)param.first, param.second, requires_grad && param_array._requires_grad[param.first]);
+            }
+        }
+    };
+    add_module(*this, true);
+
+    if (_flat_size == 0) {
+        throw std::runtime_error("Flat module has no parameters");
+    }
+}
+
+void Module::initialize_flat_input() {
+    build_flat_layout();
+    //all the parameter shapes are known, so there is nothing to assert
+    set_flat_buffer(tf.attr("input")(vector<int>{_flat_size}, TFType::Float));
+}
+
+void Module::initialize_flat_parameters() {
+    build_flat_layout();
+    py::object np = py::module::import("numpy");
+    py::list arrays;
+    for (auto& entry : _flat_layout) {
+        arrays.append(initialize_parameter_array(entry.param).attr("ravel")());
+    }
+    set_flat_buffer(tf.attr("tensor")(np.attr("concatenate")(arrays).attr("astype")(np.attr("float32"))));
+}
+
+void Module::set_flat_buffer(py::object buffer) {
+    build_flat_layout();
+    _flat_buffer = buffer;
+    _flat_buffer_stale = false;
+    _flat_in_program = py::isinstance<PyTensor>(buffer);
+    if (_flat_in_program) {
+        _flat_views_stale = false;
+        set_flat_views();
+    } else {
+        //read back lazily, only if the parameters are accessed on the host
+        _flat_views_stale = true;
+    }
+}
+
+void Module::set_flat_views() {
+    const Tensor& buffer = T(py::cast<PyTensor&>(_flat_buffer));
+    for (auto& entry : _flat_layout) {
+        Tensor& view = Tensor::Load(buffer, {&PackedIndex(ConstantShape(entry.param.shape), entry.offset)}, IndexingMode::Unsafe);
+        FlatParameterValue(entry) = py::cast(PT(view));
+    }
+}
+
+void Module::update_flat_views() {
+    if (!_flat_views_stale) {
+        return;
+    }
+    _flat_views_stale = false;
+    py::object data = _flat_buffer.attr("numpy");
+    for (auto& entry : _flat_layout) {
+        py::object slice = data[py::slice(entry.offset, entry.offset + entry.size, 1)];
+        FlatParameterValue(entry) = tf.attr("tensor")(slice.attr("reshape")(py::cast(entry.param.shape)));
+    }
+}
+
+py::object Module::pack_flat_parameters() {
+    if (!_flat_buffer_stale) {
+        return _flat_buffer;
+    }
+
+    if (_flat_in_program) {
+        Tensor& packed = Tensor::Constant(Tensors{&Tensor::Constant(_flat_size)}, 0.0f);
+        for (auto& entry : _flat_layout) {
+            const Tensor& value = T(py::cast<PyTensor&>(FlatParameterValue(entry)));
+            Tensor::Store(packed, value, {&PackedIndex(ConstantShape(entry.param.shape), entry.offset)}, true);
+        }
+        _flat_buffer = py::cast(PT(packed));
+    } else {
+        py::object np = py::module::import("numpy");
+        py::list arrays;
+        for (auto& entry : _flat_layout) {
+            arrays.append(FlatParameterValue(entry).attr("numpy").attr("ravel")());
+        }
+        _flat_buffer = tf.attr("tensor")(np.attr("concatenate")(arrays).attr("astype")(np.attr("float32")));
+    }
+    _flat_buffer_stale = false;
+    return _flat_buffer;
+}
+
+py::object Module::flat_gradient(py::object loss) {
+    if (!_flat_in_program) {
+        throw std::runtime_error("Gradients of flat parameters can only be computed inside a TensorProgram");
+    }
+
+    //the gradients of the views are stored into one buffer instead of scattering them into the flat input
+    Tensor& packed = Tensor::Constant(Tensors{&Tensor::Constant(_flat_size)}, 0.0f);
+    for (auto& entry : _flat_layout) {
+        if (!entry.requires_grad) {
+            continue;
+        }
+        py::object grad = tf.attr("grad")(loss, FlatParameterValue(entry));
+        Tensor::Store(packed, T(py::cast<PyTensor&>(grad)), {&PackedIndex(ConstantShape(entry.param.shape), entry.offset)}, true);
+    }
+    return py::cast(PT(packed));
+}
+
+Module* Module::flat_owner(py::object param) {
+    if (flat) {
+        return _flat_buffer.is(param) ? this : nullptr;
+    }
+    for (auto& module : get_attributes_of_type(AttributeType::Module)) {
+        Module* owner = py::cast<Module&>(module.second).flat_owner(param);
+        if (owner != nullptr) {
+            return owner;
+        }
+    }
+    return nullptr;
+}
+
 class PyModule : public Module {
 public:
     using Module::Module; // Inherit constructors
@@ -33,8 +219,14 @@ public:
     OptimizerType optimizer_type;
     const float epsilon = 1e-8f;
 
-    ModuleOptimizer(OptimizerType type, Module* net, map<string, py::object> params)
-        : PyModule(), optimizer_type(type) {
+    // if fused, the gradients and the optimizer state of all parameters are packed into flat buffers
+    // and updated together, instead of tracing a separate update for every parameter
+    bool fused = false;
+    vector<int> packed_offsets; // offset of every parameter in the packed buffers, -1 if not trained
+    int packed_size = 0;
+
+    ModuleOptimizer(OptimizerType type, Module* net, map<string, py::object> params, bool fused = false)
+        : PyModule(), optimizer_type(type), fused(fused) {
         setattr("net", py::cast(net));
 
         for (auto& [name, value] : params) {
@@ -50,20 +242,52 @@ public:
     void initializeOptimizer(Module* net) {
         py::list net_params = net->parameters();
         py::list requires_grads = net->requires_grads_list();
+        if (fused) {
+            initializePackedOffsets(net_params, requires_grads);
+        }
         switch (optimizer_type) {
             case OptimizerType::ADAM:
-                initializeParameterArray("m", net_params, requires_grads);
-                initializeParameterArray("v", net_params, requires_grads);
+                initializeState("m", net_params, requires_grads);
+                initializeState("v", net_params, requires_grads);
                 break;
             case OptimizerType::SGD:
                 // No additional parameters needed
                 break;
             case OptimizerType::RMSProp:
-                initializeParameterArray("v", net_params, requires_grads);
+                initializeState("v", net_params, requires_grads);
                 break;
         }
     }
 
+    void initializePackedOffsets(py::list& net_params, py::list& requires_grads) {
+        packed_offsets.clear();
+        packed_size = 0;
+        for (size_t i = 0; i < py::len(net_params); ++i) {
+            if (!py::cast<bool>(requires_grads[i])) {
+                packed_offsets.push_back(-1);
+                continue;
+            }
+            py::object param = net_params[i];
+            int size = 1;
+            for (int dim : py::cast<Parameter&>(param).shape) {
+                if (dim <= 0) {
+                    throw std::runtime_error("Fused optimizer requires parameters with known shapes");
+                }
+                size *= dim;
+            }
+            packed_offsets.push_back(packed_size);
+            packed_size += size;
+        }
+    }
+
+    void initializeState(const string& name, py::list& net_params, py::list& requires_grads) {
+        if (fused) {
+            setattr(name, py::cast(Parameter({packed_size}, TFType::Float, false)));
+        } else {
+            initializeParameterArray(name, net_params, requires_grads);
+        }
+    }
+
     void initializeParameterArray(const string& name, py::list& net_params, py::list& requires_grads) {
         setattr(name, py::cast(ParameterArray()));
         for (size_t i = 0; i < py::len(net_params); ++i) {
@@ -77,6 +301,11 @@ public:
     }
 
     void assert_parameters() override {
+        if (fused) {
+            assertPackedState("m");
+            assertPackedState("v");
+            return;
+        }
         py::list net_params = getattr("net").attr("parameters")();
         py::list requires_grads = getattr("net").attr("requires_grads_list")();
         assertParameterArray("m", net_params, requires_grads);
@@ -100,6 +329,28 @@ public:
         }
     }
 
+    void assertPackedState(const string& name) {
+        if (hasattr(name)) {
+            const Tensor& state = T(py::cast<PyTensor&>(getattr(name)));
+            setattr(name, py::cast(PT(Tensor::Assert(state, Tensors{&Tensor::Constant(packed_size)}, TFType::Float))));
+        }
+    }
+
+    py::object getState(const string& name, size_t i) {
+        if (fused) {
+            return getattr(name);
+        }
+        return py::cast<ParameterArray&>(getattr(name)).getitem(i);
+    }
+
+    void setState(const string& name, size_t i, py::object value) {
+        if (fused) {
+            setattr(name, value);
+        } else {
+            py::cast<ParameterArray&>(getattr(name)).setitem(i, value);
+        }
+    }
+
     py::object step(py::object X, py::object Y) {
         py::object net = getattr("net");
         py::object loss = net.attr("loss")(X, Y);
@@ -121,6 +372,13 @@ public:
         py::object grad_clip = getattr("grad_clip");
 
         bool has_clip = py::isinstance<py::float_>(grad_clip) && py::cast<float>(grad_clip) > 0.0f;
+        if (fused) {
+            fusedStep(net, loss, t, net_params, learning_rate, has_clip ? grad_clip : py::object(py::none()));
+            net.attr("update_parameters")(net_params);
+            Tensor::EndRegion("OptimizerStep");
+            return;
+        }
+
         Tensor::BeginRegion("UpdateWeights");
         for (size_t i = 0; i < py::len(net_params); ++i) {
             bool requires_grad = py::cast<bool>(requires_grads[i]);
@@ -128,7 +386,7 @@ public:
                 continue;
             }
             py::object param = net_params[i];
-            py::object grad = tf.attr("grad")(loss, param);
+            py::object grad = gradient(net, loss, param);
             if(has_clip) {
                 grad = tf.attr("clamp")(grad, -grad_clip, grad_clip);
             }
@@ -155,12 +413,72 @@ public:
     }
 
 private:
+    //gradients of flat parameter buffers are packed from the gradients of their views
+    py::object gradient(py::object& net, py::object& loss, py::object& param) {
+        Module* owner = py::cast<Module&>(net).flat_owner(param);
+        if (owner != nullptr) {
+            return owner->flat_gradient(loss);
+        }
+        return tf.attr("grad")(loss, param);
+    }
+
+    void fusedStep(py::object& net, py::object& loss, py::object& t, py::list& net_params, py::object& learning_rate, py::object grad_clip) {
+        if (packed_offsets.size() != py::len(net_params)) {
+            throw std::runtime_error("Fused optimizer: the parameter count changed after the optimizer was created");
+        }
+
+        //write the gradients into one buffer, the stores are fused into the kernels computing the gradients
+        Tensor::BeginRegion("PackGradients");
+        Tensor& packed_grad = Tensor::Constant(Tensors{&Tensor::Constant(packed_size)}, 0.0f);
+        for (size_t i = 0; i < py::len(net_params); ++i) {
+            if (packed_offsets[i] < 0) {
+                continue;
+            }
+            py::object param = net_params[i];
+            py::object grad = gradient(net, loss, param);
+            const Tensor& param_tensor = T(py::cast<PyTensor&>(param));
+            Tensor::Store(packed_grad, T(py::cast<PyTensor&>(grad)), {&PackedIndex(param_tensor.GetShape(), packed_offsets[i])}, true);
+        }
+        Tensor::EndRegion("PackGradients");
+
+        //update the state of all parameters in one elementwise pass
+        Tensor::BeginRegion("UpdateWeights");
+        py::object grad = py::cast(PT(packed_grad));
+        if (!grad_clip.is_none()) {
+            grad = tf.attr("clamp")(grad, -grad_clip, grad_clip);
+        }
+        py::object update;
+        switch (optimizer_type) {
+            case OptimizerType::ADAM:
+                update = adam_update(0, grad, grad, t, learning_rate);
+                break;
+            case OptimizerType::SGD:
+                update = sgd_update(grad, grad, learning_rate);
+                break;
+            case OptimizerType::RMSProp:
+                update = rmsprop_update(0, grad, grad, learning_rate);
+                break;
+        }
+
+        const Tensor& packed_update = T(py::cast<PyTensor&>(update));
+        for (size_t i = 0; i < py::len(net_params); ++i) {
+            if (packed_offsets[i] < 0) {
+                continue;
+            }
+            py::object param = net_params[i];
+            const Tensor& param_tensor = T(py::cast<PyTensor&>(param));
+            const Tensor& param_update = Tensor::Load(packed_update, {&PackedIndex(param_tensor.GetShape(), packed_offsets[i])}, IndexingMode::Unsafe);
+            net_params[i] = py::cast(PT(param_tensor - param_update));
+        }
+        Tensor::EndRegion("UpdateWeights");
+    }
+
     py::object adam_update(size_t i, py::object& param, py::object& grad, py::object& t, py::object& learning_rate) {
         float beta1 = py::cast<float>(getattr("beta1"));
         float beta2 = py::cast<float>(getattr("beta2"));
 
-        py::object m = py::cast<ParameterArray&>(getattr("m")).getitem(i);
-        py::object v = py::cast<ParameterArray&>(getattr("v")).getitem(i);
+        py::object m = getState("m", i);
+        py::object v = getState("v", i);
 
         m = tf.attr("lerp")(grad, m, beta1);
         v = tf.attr("lerp")(grad.attr("__mul__")(grad), v, beta2);
@@ -168,8 +486,8 @@ private:
         py::object mhat = m.attr("__truediv__")(py::float_(1.0) - tf.attr("pow")(beta1, t.attr("__getitem__")(0)));
         py::object vhat = v.attr("__truediv__")(py::float_(1.0) - tf.attr("pow")(beta2, t.attr("__getitem__")(0)));
 
-        py::cast<ParameterArray&>(getattr("m")).setitem(i, m);
-        py::cast<ParameterArray&>(getattr("v")).setitem(i, v);
+        setState("m", i, m);
+        setState("v", i, v);
 
         return mhat.attr("__truediv__")(tf.attr("sqrt")(vhat).attr("__add__")(epsilon)).attr("__mul__")(learning_rate);
     }
@@ -181,9 +499,9 @@ private:
     py::object rmsprop_update(size_t i, py::object& param, py::object& grad, py::object& learning_rate) {
         float decay = py::cast<float>(getattr("decay"));
 
-        py::object v = py::cast<ParameterArray&>(getattr("v")).getitem(i);
+        py::object v = getState("v", i);
         v = tf.attr("lerp")(grad.attr("__mul__")(grad), v, decay);
-        py::cast<ParameterArray&>(getattr("v")).setitem(i, v);
+        setState("v", i, v);
 
         return grad.attr("__mul__")(learning_rate).attr("__truediv__")(tf.attr("sqrt")(v).attr("__add__")(epsilon));
     }
@@ -206,7 +524,7 @@ void ModuleDefinitions(py::module& m) {
         .def("__setitem__", &ParameterArray::setitem);
 
     py::class_<Module, PyModule>(m, "Module")
-        .def(py::init<bool>(), py::arg("requires_grad") = true)
+        .def(py::init<bool, bool>(), py::arg("requires_grad") = true, py::arg("flat") = false)
         .def("__getattr__", &Module::getattr)
         .def("__setattr__", &Module::setattr)
         .def("hasattr", &Module::hasattr)
@@ -227,7 +545,7 @@ void ModuleDefinitions(py::module& m) {
         .value("RMSProp", ModuleOptimizer::OptimizerType::RMSProp);
 
     py::class_<ModuleOptimizer, Module>(m, "ModuleOptimizer")
-        .def(py::init<ModuleOptimizer::OptimizerType, Module*, map<string, py::object>>(), py::arg("type"), py::arg("net"), py::arg("params"))
+        .def(py::init<ModuleOptimizer::OptimizerType, Module*, map<string, py::object>, bool>(), py::arg("type"), py::arg("net"), py::arg("params"), py::arg("fused") = false)
         .def("assert_parameters", &ModuleOptimizer::assert_parameters)
         .def("step", py::overload_cast<py::object, py::object>(&ModuleOptimizer::step))
         .def("step", py::overload_cast<py::object>(&ModuleOptimizer::step));
@@ -235,38 +553,38 @@ void ModuleDefinitions(py::module& m) {
     py::module optimizers = m.def_submodule("optimizers", "Optimizers submodule");
 
     optimizers.def("adam",
-        [](Module* net, py::object learning_rate, py::object beta1, py::object beta2, py::object clip) {
+        [](Module* net, py::object learning_rate, py::object beta1, py::object beta2, py::object clip, bool fused) {
             return new ModuleOptimizer(ModuleOptimizer::OptimizerType::ADAM, net, {
                 {"learning_rate", learning_rate},
                 {"beta1", beta1},
                 {"beta2", beta2},
                 {"grad_clip", clip}
-            });
+            }, fused);
         },
-        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("beta1") = 0.9f, py::arg("beta2") = 0.999f, py::arg("clip") = 0.0f,
+        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("beta1") = 0.9f, py::arg("beta2") = 0.999f, py::arg("clip") = 0.0f, py::arg("fused") = false,
         py::return_value_policy::take_ownership
     );
 
     optimizers.def("sgd",
-        [](Module* net, py::object learning_rate, py::object clip) {
+        [](Module* net, py::object learning_rate, py::object clip, bool fused) {
             return new ModuleOptimizer(ModuleOptimizer::OptimizerType::SGD, net, {
                 {"learning_rate", learning_rate},
                 {"grad_clip", clip}
-            });
+            }, fused);
         },
-        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("clip") = 0.0f,
+        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("clip") = 0.0f, py::arg("fused") = false,
         py::return_value_policy::take_ownership
     );
 
     optimizers.def("rmsprop",
-        [](Module* net, py::object learning_rate, py::object decay, py::object clip) {
+        [](Module* net, py::object learning_rate, py::object decay, py::object clip, bool fused) {
             return new ModuleOptimizer(ModuleOptimizer::OptimizerType::RMSProp, net, {
                 {"learning_rate", learning_rate},
                 {"decay", decay},
                 {"grad_clip", clip}
-            });
+            }, fused);
         },
-        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("decay") = 0.9f, py::arg("clip") = 0.0f,
+        py::arg("net"), py::arg("learning_rate") = 0.001f, py::arg("decay") = 0.9f, py::arg("clip") = 0.0f, py::arg("fused") = false,
         py::return_value_policy::take_ownership
     );
 }
@@ -100,6 +100,11 @@ void PyTensorDefinition(py::module& /*m*/, py::class_<PyTensor>& py_tensor) {
 		return t;
 	});
 
+	py_tensor.def("checkpoint", [](const PyTensor& t) {
+		t.Get().Checkpoint();
+		return t;
+	});
+
 	// operators
 	DefineOperators(py_tensor);
 
@@ -61,6 +61,7 @@ void TensorFunctionsDefinition(py::module& m) {
 	BINARY_FUNCTION(modf);
 
 	BINARY_FUNCTION(grad);
+	TERNARY_FUNCTION(jvp);
 
 	TERNARY_FUNCTION(clamp);
 	TERNARY_FUNCTION(fma);
@@ -256,6 +257,15 @@ void TensorFunctionsDefinition(py::module& m) {
 		return PT(Tensor::Matmul(T(t), T(t2)));
 	}, py::arg("t"), py::arg("t2"), "Matrix multiplication of two tensors");
 
+	m.def("checkpoint", [](const PyTensor& t) {
+		t.Get().Checkpoint();
+		return t;
+	}, py::arg("t"), "Keep this value for the backward pass, the values between checkpoints are recomputed instead of being stored");
+
+	m.def("enable_rematerialization", [](bool enable) {
+		rematerialize_forward_values = enable;
+	}, py::arg("enable") = true, "Recompute forward values in the backward pass instead of keeping them, applies to programs compiled afterwards");
+
 	m.def("region_begin", [](const std::string& name) {
 		Tensor::BeginRegion(name);
 	}, py::arg("name"), "Begin a debug region");
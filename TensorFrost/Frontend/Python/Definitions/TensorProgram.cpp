@@ -11,7 +11,7 @@ void TensorProgramDefinition(py::module& m,
                              py::class_<TensorProgram>& tensor_program) {
 	m.def(
 	    "compile",
-	    [](const py::function& py_evaluate) {
+	    [](const py::function& py_evaluate, bool specialize) {
 		    // Extract the name of the Python function
 		    std::string func_name =
 		        py_evaluate.attr("__name__").cast<std::string>();
@@ -35,11 +35,13 @@ void TensorProgramDefinition(py::module& m,
 		        	return outputs;
 		        },
 		        func_name);
+		    program.specialize = specialize;
 		    
 		    py::print(program.PrintProperties());
 			return &program;
 	    },
-	    "Compile a TensorProgram from a python function");
+	    py::arg("function"), py::arg("specialize") = false,
+	    "Compile a TensorProgram from a python function, if specialize is set a version with constant input shapes is compiled for every new input signature");
 
 	tensor_program.def(
 	    "__call__",
@@ -126,6 +128,38 @@ void TensorProgramDefinition(py::module& m,
 	    },
 	    "Evaluate the TensorProgram with the given inputs");
 
+	tensor_program.def(
+	    "tune",
+	    [](TensorProgram& program, py::args py_inputs, int repeats) {
+		    vector<TFTensor*> inputs;
+		    for (auto arg : py_inputs) {
+			    if (py::isinstance<PyTensorMemory>(arg)) {
+				    inputs.push_back(arg.cast<PyTensorMemory&>().tensor_);
+			    } else if (py::isinstance<Module>(arg)) {
+				    py::list params = arg.cast<Module&>().parameters();
+				    for (auto param : params) {
+					    inputs.push_back(param.cast<PyTensorMemory&>().tensor_);
+				    }
+			    } else {
+				    throw std::runtime_error("Unsupported input type for tuning " + std::string(py::str(arg)));
+			    }
+		    }
+
+		    py::dict result;
+		    for (auto& [kernel_index, group_size] : program.Tune(inputs, repeats)) {
+			    result[py::str(program.program->kernels_[kernel_index].kernel_name_)] = py::tuple(py::cast(group_size));
+		    }
+		    return result;
+	    },
+	    py::arg("repeats") = 10,
+	    "Time work group size variants of every kernel with the given inputs and use the fastest ones for inputs of the same shape bucket");
+
+	tensor_program.def_readwrite("specialize", &TensorProgram::specialize,
+	    "Compile a version with constant input shapes on the first call with each new input signature");
+
+	tensor_program.def_readwrite("autotune", &TensorProgram::autotune,
+	    "Tune the work group sizes on the first call with each new shape bucket");
+
 	tensor_program.def(
 	    "list_operations",
 	    [](TensorProgram& program, bool compact) {
@@ -135,6 +169,148 @@ void TensorProgramDefinition(py::module& m,
 	    },
 	    py::arg("compact") = true);
 
+	tensor_program.def("compile_stats", [](TensorProgram& program) {
+		py::list passes;
+		for (const IR::PassStats& stats : program.ir.pass_stats) {
+			py::dict pass;
+			pass["name"] = stats.pass_name;
+			pass["time_ms"] = stats.duration;
+			pass["nodes_before"] = stats.nodes_before;
+			pass["nodes_after"] = stats.nodes_after;
+			pass["kernels"] = stats.kernel_count;
+			passes.append(pass);
+		}
+
+		py::dict result;
+		result["passes"] = passes;
+		result["ir_compile_time_ms"] = program.ir_compile_time;
+		result["codegen_time_ms"] = program.codegen_time;
+		result["host_compile_time_ms"] = program.program->host_compile_time;
+		result["library_load_time_ms"] = program.program->library_load_time;
+		result["kernel_compile_time_ms"] = program.kernel_compile_time;
+		result["external_compile_time_ms"] = program.external_compile_time;
+		return result;
+	}, "Get the per pass compilation statistics and the compile time breakdown (in ms)");
+
+	tensor_program.def("properties", [](TensorProgram& program) {
+		py::dict result;
+		result["kernels"] = program.program->kernels_.size();
+		result["intermediate_buffers"] = program.ir.temp_memory_count;
+		result["host_readbacks"] = program.ir.readbacks;
+		result["host_writes"] = program.ir.writebacks;
+		result["compile_time_ms"] = program.compile_time;
+		return result;
+	}, "Get the properties printed at compilation (kernel, intermediate buffer and host transfer counts) as a dict");
+
+	tensor_program.def("profile", [](TensorProgram& program) {
+		if (global_kernel_manager == nullptr) {
+			throw std::runtime_error("Backend is not initialized");
+		}
+
+		auto stats_to_dict = [](const TimingStats& stats) {
+			py::dict result;
+			result["count"] = stats.count;
+			result["total_ms"] = stats.total_time;
+			result["min_ms"] = stats.count > 0 ? stats.min_time : 0.0;
+			result["max_ms"] = stats.max_time;
+			result["avg_ms"] = stats.count > 0 ? stats.total_time / (double)stats.count : 0.0;
+			result["work_groups"] = stats.work_groups;
+			return result;
+		};
+
+		py::dict kernels;
+		for (auto& kernel : program.program->kernels_) {
+			if (!global_kernel_manager->kernel_stats.contains(kernel.kernel_id_)) {
+				continue;
+			}
+			py::dict kernel_stats = stats_to_dict(global_kernel_manager->kernel_stats[kernel.kernel_id_]);
+			kernel_stats["name"] = kernel.kernel_name_;
+			kernels[py::int_(kernel.kernel_id_)] = kernel_stats;
+		}
+
+		py::dict regions;
+		for (auto& [name, stats] : global_kernel_manager->region_stats[program.program]) {
+			regions[py::str(name)] = stats_to_dict(stats);
+		}
+
+		py::dict result;
+		result["kernels"] = kernels;
+		result["regions"] = regions;
+		return result;
+	}, "Get the kernel and region timings (in ms) gathered while profiling was enabled");
+
+	tensor_program.def("kernel_report", [](TensorProgram& program, const vector<vector<int>>& input_shapes) {
+		py::list result;
+		for (const KernelCostReport& report : GetKernelCostReport(program.program, input_shapes)) {
+			py::dict kernel;
+			kernel["name"] = report.kernel->kernel_name_;
+			kernel["id"] = report.kernel->kernel_id_;
+
+			py::dict per_thread;
+			per_thread["loads"] = report.loads;
+			per_thread["stores"] = report.stores;
+			per_thread["atomics"] = report.atomics;
+			per_thread["flops"] = report.flops;
+			per_thread["special_ops"] = report.special_ops;
+			per_thread["int_ops"] = report.int_ops;
+			per_thread["bytes"] = report.BytesPerThread();
+			kernel["per_thread"] = per_thread;
+
+			kernel["threads_expr"] = report.threads_expr;
+			kernel["loop_trip_exprs"] = report.loop_trip_exprs;
+			kernel["exact"] = report.exact;
+			if (report.threads >= 0.0) {
+				py::dict total;
+				total["threads"] = report.threads;
+				total["loads"] = report.loads * report.threads;
+				total["stores"] = report.stores * report.threads;
+				total["atomics"] = report.atomics * report.threads;
+				total["flops"] = report.flops * report.threads;
+				total["special_ops"] = report.special_ops * report.threads;
+				total["bytes"] = report.BytesPerThread() * report.threads;
+				kernel["total"] = total;
+			} else {
+				kernel["total"] = py::none();
+			}
+
+			double intensity = report.ArithmeticIntensity();
+			kernel["arithmetic_intensity"] = intensity == DBL_MAX ? py::object(py::float_(INFINITY)) : py::object(py::float_(intensity));
+			kernel["fusion_candidate"] = report.fusion_candidate;
+			result.append(kernel);
+		}
+		return result;
+	}, py::arg("input_shapes") = vector<vector<int>>(),
+	   "Static per kernel estimate of memory traffic and arithmetic, totals are evaluated for the given input shapes");
+
+	m.def("enable_profiling", [](bool enable) {
+		if (global_kernel_manager == nullptr) {
+			throw std::runtime_error("Backend is not initialized");
+		}
+		global_kernel_manager->profiling_enabled = enable;
+	}, py::arg("enable") = true, "Enable timing of every kernel dispatch and region, has a synchronization overhead on GPU backends");
+
+	m.def("reset_profiling", []() {
+		if (global_kernel_manager == nullptr) {
+			throw std::runtime_error("Backend is not initialized");
+		}
+		global_kernel_manager->ResetProfiling();
+	}, "Clear all gathered profiling data");
+
+	m.def("enable_tiered_compilation", [](bool enable, const std::string& compile_options) {
+		tiered_compilation = enable;
+		optimized_compile_options = compile_options;
+	}, py::arg("enable") = true, py::arg("compile_options") = "",
+	   "Run new CPU programs in the interpreter while they are compiled in the background, they switch to the compiled code once it is ready (default options are -O3 -march=native)");
+
+	m.def("wait_for_compilation", []() { UpgradeHostPrograms(true); },
+	      "Wait for all background compilations and switch their programs to the compiled code");
+
+	m.def("start_trace", []() { StartTrace(); },
+	      "Start recording dispatches, regions, allocations and transfers");
+
+	m.def("stop_trace", [](const std::string& path) { StopTrace(path); }, py::arg("path"),
+	      "Stop recording and write the trace as Chrome trace JSON (can be opened in Perfetto)");
+
 	tensor_program.def("compiled_code", [](TensorProgram& program) {
 		string code = program.program->generated_code_;
 		return py::str(code);
@@ -20,24 +20,16 @@ public:
         : shape(shape), dtype(dtype), random_scale(random_scale), random_offset(random_offset), requires_grad(requires_grad) {}
 };
 
+class Module;
+
 class ParameterArray {
 public:
     map<size_t, py::object> _parameters; //must be sorted
     map<size_t, bool> _requires_grad;
+    Module* _flat_root = nullptr; //module owning the flat buffer these parameters are stored in
 
-    py::object getitem(size_t index) {
-        if (_parameters.contains(index)) {
-            return _parameters[index];
-        }
-        throw py::index_error("Index " + std::to_string(index) + " is not in the ParameterArray");
-    }
-
-    void setitem(size_t index, py::object value) {
-        _parameters[index] = value;
-        if (py::isinstance<Parameter>(value)) {
-            _requires_grad[index] = py::cast<Parameter&>(value).requires_grad;
-        }
-    }
+    py::object getitem(size_t index);
+    void setitem(size_t index, py::object value);
 };
 
 class Module {
@@ -49,20 +41,44 @@ public:
         Module
     };
 
+    struct FlatParameter {
+        Module* module;
+        string name;
+        int array_index; //-1 if the parameter is an attribute of the module
+        Parameter param;
+        bool requires_grad;
+        int offset;
+        int size;
+    };
+
     map<string, py::object> _attributes;
     map<string, AttributeType> _attribute_types;
     map<string, bool> _requires_grad;
     vector<string> _attribute_order;
     bool requires_grad = true;
 
+    // if flat, all parameters of the module tree are stored in a single buffer,
+    // and the parameter attributes are views into it
+    bool flat = false;
+    vector<FlatParameter> _flat_layout;
+    int _flat_size = 0;
+    py::object _flat_buffer;
+    bool _flat_in_program = false;
+    bool _flat_buffer_stale = false; //a parameter was assigned, the buffer must be packed again
+    bool _flat_views_stale = false; //the buffer was updated on the host, the parameters must be read back
+    Module* _flat_root = nullptr;
+
     py::object tf;
 
-    Module(bool requires_grad = true) : requires_grad(requires_grad) {
+    Module(bool requires_grad = true, bool flat = false) : requires_grad(requires_grad), flat(flat) {
         tf = py::module::import("TensorFrost");
     }
 
     py::object getattr(const std::string& name) {
         if (_attributes.contains(name)) {
+            if (_flat_root != nullptr && _attribute_types[name] == AttributeType::Parameter) {
+                _flat_root->update_flat_views();
+            }
             return _attributes[name];
         }
         throw py::attribute_error("TensorFrost Module object has no attribute with name '" + name + "'");
@@ -87,6 +103,11 @@ public:
             requires_grad = _requires_grad[name];
         }
 
+        if (_flat_root != nullptr && already_exists && _attribute_types[name] == AttributeType::Parameter) {
+            _flat_root->update_flat_views();
+            _flat_root->_flat_buffer_stale = true;
+        }
+
         _attributes[name] = value;
         _attribute_types[name] = type;
         _requires_grad[name] = requires_grad && this->requires_grad;
@@ -116,7 +137,22 @@ public:
 
     virtual void assert_parameters() {}
 
+    void build_flat_layout();
+    void initialize_flat_input();
+    void initialize_flat_parameters();
+    void set_flat_buffer(py::object buffer);
+    void set_flat_views();
+    void update_flat_views();
+    py::object pack_flat_parameters();
+    py::object flat_gradient(py::object loss);
+    Module* flat_owner(py::object param);
+
     void initialize_input() {
+        if (flat) {
+            initialize_flat_input();
+            return;
+        }
+
         for (auto& module : get_attributes_of_type(AttributeType::Module)) {
             module.second.attr("initialize_input")();
         }
@@ -140,6 +176,10 @@ public:
     }
 
     py::object initialize_parameter(Parameter& param) {
+        return tf.attr("tensor")(initialize_parameter_array(param));
+    }
+
+    py::array_t<float> initialize_parameter_array(Parameter& param) {
         py::object np = py::module::import("numpy");
         py::object random = np.attr("random");
 
@@ -157,10 +197,15 @@ public:
         }
         arr = arr.attr("__mul__")(py::float_(scale));
         arr = arr.attr("__add__")(py::float_(param.random_offset));
-        return tf.attr("tensor")(arr);
+        return arr;
     }
 
     void initialize_parameters() {
+        if (flat) {
+            initialize_flat_parameters();
+            return;
+        }
+
         for (auto& module : get_attributes_of_type(AttributeType::Module)) {
             module.second.attr("initialize_parameters")();
         }
@@ -183,6 +228,17 @@ public:
 
     py::list parameters() {
         py::list params;
+        if (flat) {
+            if (!_flat_buffer) {
+                //not initialized yet, describe the whole buffer as a single parameter
+                build_flat_layout();
+                params.append(py::cast(Parameter({_flat_size}, TFType::Float, -1.0f, 0.0f, requires_grad)));
+            } else {
+                params.append(pack_flat_parameters());
+            }
+            return params;
+        }
+
         for (auto& module : get_attributes_of_type(AttributeType::Module)) {
             params += module.second.attr("parameters")();
         }
@@ -202,6 +258,11 @@ public:
 
     py::list requires_grads_list() {
         py::list requires_grads;
+        if (flat) {
+            requires_grads.append(requires_grad);
+            return requires_grads;
+        }
+
         for (auto& module : get_attributes_of_type(AttributeType::Module)) {
             requires_grads.append( param_requires_grad(module.first) );
         }
@@ -241,6 +302,15 @@ public:
         std::function<void(Module&)> update_params;
 
         update_params = [&](Module& module) {
+            if (module.flat) {
+                if (index >= py::len(params)) {
+                    throw py::index_error("Provided more than " + std::to_string(index) + " values, but expected " + std::to_string(py::len(params)));
+                }
+                module.set_flat_buffer(params[index]);
+                index++;
+                return;
+            }
+
             for (auto& module_item : module.get_attributes_of_type(AttributeType::Module)) {
                 update_params(py::cast<Module&>(module_item.second));
             }
@@ -277,4 +347,25 @@ public:
     }
 };
 
+inline py::object ParameterArray::getitem(size_t index) {
+    if (_parameters.contains(index)) {
+        if (_flat_root != nullptr) {
+            _flat_root->update_flat_views();
+        }
+        return _parameters[index];
+    }
+    throw py::index_error("Index " + std::to_string(index) + " is not in the ParameterArray");
+}
+
+inline void ParameterArray::setitem(size_t index, py::object value) {
+    if (_flat_root != nullptr && _parameters.contains(index)) {
+        _flat_root->update_flat_views();
+        _flat_root->_flat_buffer_stale = true;
+    }
+    _parameters[index] = value;
+    if (py::isinstance<Parameter>(value)) {
+        _requires_grad[index] = py::cast<Parameter&>(value).requires_grad;
+    }
+}
+
 }
\ No newline at end of file
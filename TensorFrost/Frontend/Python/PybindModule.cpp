@@ -32,6 +32,7 @@ PYBIND11_MODULE(TensorFrost, m) {
 	backend_type.value("vulkan", BackendType::Vulkan);
 	backend_type.value("opengl", BackendType::OpenGL);
 	backend_type.value("codegen", BackendType::CodeGen);
+	backend_type.value("interpreter", BackendType::Interpreter);
 	code_gen_lang.value("cpp", CodeGenLang::CPP);
 	code_gen_lang.value("glsl", CodeGenLang::GLSL);
 	code_gen_lang.value("hlsl", CodeGenLang::HLSL);
@@ -45,6 +46,7 @@ PYBIND11_MODULE(TensorFrost, m) {
 	m.attr("vulkan") = BackendType::Vulkan;
 	m.attr("opengl") = BackendType::OpenGL;
 	m.attr("codegen") = BackendType::CodeGen;
+	m.attr("interpreter") = BackendType::Interpreter;
 
 	m.attr("cpp_lang") = CodeGenLang::CPP;
 	m.attr("glsl_lang") = CodeGenLang::GLSL;
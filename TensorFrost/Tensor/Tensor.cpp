@@ -156,6 +156,10 @@ void Tensor::PassGrad() const {
 	node_->flags.set(NodeProp::PassGrad);
 }
 
+void Tensor::Checkpoint() const {
+	node_->flags.set(NodeProp::Checkpoint);
+}
+
 Tensor* Tensor::GetCopy(const Tensor& other, NodeArguments args) {
 	Tensor* copy = &CreateNode(other.node_->type, std::move(args), other.node_->name);
 	copy->node_->data = other.node_->data;
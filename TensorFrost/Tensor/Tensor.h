@@ -235,6 +235,7 @@ public:
 	void SetType(TFType type) const;
 	void DetachGrad() const;
 	void PassGrad() const;
+	void Checkpoint() const;
 
 	static Tensor* GetCopy(const Tensor& other, NodeArguments args);
 
@@ -878,6 +879,13 @@ public:
 
 	static Tensor& reversebits(const Tensor& x) { return Op("reversebits", &x); }
 
+	//unsigned division by a runtime invariant divisor, with the multiplier and shift precomputed on the host
+	static Tensor& fastdiv(const Tensor& x, const Tensor& multiplier, const Tensor& shift) {
+		return Op("fastdiv", &x, &multiplier, &shift);
+	}
+	static Tensor& fastdiv_multiplier(const Tensor& divisor) { return Op("fastdiv_multiplier", &divisor); }
+	static Tensor& fastdiv_shift(const Tensor& divisor) { return Op("fastdiv_shift", &divisor); }
+
 	static Tensor& tofloat(const Tensor& x) { return Op("float", &x); }
 	static Tensor& toint(const Tensor& x) { return Op("int", &x); }
 	static Tensor& touint(const Tensor& x) { return Op("uint", &x); }
@@ -922,6 +930,14 @@ public:
 		return OpShape("backwards_grad", wrt.GetShape(), &x, &wrt);
 	}
 
+	//jacobian-vector product, derivative of x with respect to wrt in the direction of the tangent
+	static Tensor& jvp(const Tensor& x, const Tensor& wrt, const Tensor& tangent) {
+		if(x.node_->op->HasAllTypes(OpProp::Nondiff) && !x.node_->flags.has(NodeProp::Modified)) {
+			throw std::runtime_error("Cannot compute gradient of a non-differentiable operation");
+		}
+		return OpShape("forward_grad", x.GetShape(), &x, &wrt, &tangent);
+	}
+
 	static Tensor& lerp(const Tensor& x, const Tensor& y, const Tensor& a) {
 		return Op("lerp", &x, &y, &a);
 	}
@@ -1,19 +1,17 @@
 #include <sstream>
 #include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
 #include "TensorProgram.h"
 
 namespace TensorFrost {
 
-void TensorProgram::CreateProgram(string name) {
-	Tensor::SetEvaluationContext(nullptr);
-
-	//get current time
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// create new IR graph
-	Tensor::SetEvaluationContext(&ir);
+void TraceProgram(const TensorProgram::EvaluateFunction& evaluate, IR* ir, const string& name) {
+	Tensor::SetEvaluationContext(ir);
 	Tensor::BeginRegion(name);
-	Tensors outputs = evaluate_callback();
+	Tensors outputs = evaluate();
 	Tensor::EndRegion(name);
 	// set outputs
 	for (int i = 0; i < outputs.size(); i++) {
@@ -23,22 +21,39 @@ void TensorProgram::CreateProgram(string name) {
 	if (outputs.size() == 0) {
 		throw std::runtime_error("TensorProgram does not do any computation: no outputs");
 	}
+}
+
+void TensorProgram::CreateProgram(string name) {
+	Tensor::SetEvaluationContext(nullptr);
+
+	//get current time
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// create new IR graph
+	TraceProgram(evaluate_callback, &ir, name);
 
 	program = GenerateProgram(&ir);
 	program->program_name = name;
 
 	Tensor::SetEvaluationContext(nullptr);
 
+	auto ir_end = std::chrono::high_resolution_clock::now();
+	ir_compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(ir_end - start).count() / 1000000.0f;
+
 	GenerateCode(program);
 
 	//get current time
 	auto end = std::chrono::high_resolution_clock::now();
 	compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0f;
+	codegen_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - ir_end).count() / 1000000.0f;
 
 	if (current_backend != BackendType::CodeGen) // no need to compile if we are in codegen mode
 	{
-		CompileAndLoadKernelModule(program, program_id);
+		LoadHostProgram(program, program_id);
+		auto kernels_start = std::chrono::high_resolution_clock::now();
 		CompileKernels(program);
+		auto kernels_end = std::chrono::high_resolution_clock::now();
+		kernel_compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(kernels_end - kernels_start).count() / 1000000.0f;
 	}
 
 	auto external_end = std::chrono::high_resolution_clock::now();
@@ -46,8 +61,321 @@ void TensorProgram::CreateProgram(string name) {
 }
 
 vector<TFTensor*> TensorProgram::Evaluate(
-    const vector<TFTensor*>& input) const {
-	return ExecuteProgram(program, input);
+    const vector<TFTensor*>& input) {
+	return ExecuteProgram(GetProgramForInputs(input), input);
+}
+
+//inputs with shapes rounded up to the same powers of two share the tuned group sizes
+string GetShapeBucket(const vector<TFTensor*>& input) {
+	string bucket;
+	for (size_t i = 0; i < input.size(); i++) {
+		if (i != 0) bucket += ",";
+		for (size_t d = 0; d < input[i]->dim; d++) {
+			size_t size = 1;
+			while (size < input[i]->shape[d]) size *= 2;
+			bucket += (d != 0 ? "x" : "") + to_string(size);
+		}
+	}
+	return "[" + bucket + "]";
+}
+
+vector<vector<int>> GetGroupSizeCandidates(int dims) {
+	switch (dims) {
+		case 1:
+			return {{256}, {64}, {128}, {512}, {1024}};
+		case 2:
+			return {{16, 16}, {8, 32}, {32, 8}, {4, 64}, {1, 256}};
+		default:
+			return {{8, 8, 8}, {4, 8, 16}, {2, 16, 16}, {1, 16, 32}, {16, 8, 4}};
+	}
+}
+
+string GroupSizesToString(const unordered_map<size_t, vector<int>>& group_sizes) {
+	map<size_t, vector<int>> sorted(group_sizes.begin(), group_sizes.end());
+	string result;
+	for (auto& [kernel_signature, group_size] : sorted) {
+		if (!result.empty()) result += ";";
+		result += to_string(kernel_signature) + "=";
+		for (size_t i = 0; i < group_size.size(); i++) {
+			result += (i != 0 ? "," : "") + to_string(group_size[i]);
+		}
+	}
+	return result;
+}
+
+unordered_map<size_t, vector<int>> GroupSizesFromString(const string& str) {
+	unordered_map<size_t, vector<int>> group_sizes;
+	stringstream stream(str);
+	string kernel;
+	while (getline(stream, kernel, ';')) {
+		size_t eq = kernel.find('=');
+		if (eq == string::npos) continue;
+		vector<int> group_size;
+		stringstream sizes(kernel.substr(eq + 1));
+		string size;
+		while (getline(sizes, size, ',')) {
+			group_size.push_back(stoi(size));
+		}
+		group_sizes[stoull(kernel.substr(0, eq))] = group_size;
+	}
+	return group_sizes;
+}
+
+filesystem::path GetTuningCachePath() {
+	return filesystem::temp_directory_path() / "tensorfrost_autotune.txt";
+}
+
+string GetTuningKey(Program* program, const string& bucket) {
+	size_t code_hash = hash<string>()(program->generated_code_);
+	for (auto& kernel : program->kernels_) {
+		HashCombine(code_hash, hash<string>()(kernel.full_generated_code_));
+	}
+	return program->program_name + ":" + to_string(code_hash) + ":" + bucket;
+}
+
+#define MAX_TUNING_CACHE_ENTRIES 256
+
+//the cache entries as key and group sizes, oldest first
+vector<pair<string, string>> ReadTuningCache() {
+	vector<pair<string, string>> entries;
+	ifstream file(GetTuningCachePath());
+	string line;
+	while (getline(file, line)) {
+		size_t space = line.find(' ');
+		if (space != string::npos) {
+			entries.push_back({line.substr(0, space), line.substr(space + 1)});
+		}
+	}
+	return entries;
+}
+
+bool LoadTunedGroupSizes(const string& key, unordered_map<size_t, vector<int>>& group_sizes) {
+	for (auto& [entry_key, entry_sizes] : ReadTuningCache()) {
+		if (entry_key == key) {
+			group_sizes = GroupSizesFromString(entry_sizes);
+			return true;
+		}
+	}
+	return false;
+}
+
+//other processes can tune at the same time, so the cache is rewritten into a temporary file and renamed over the old one
+void SaveTunedGroupSizes(const string& key, const unordered_map<size_t, vector<int>>& group_sizes) {
+	vector<pair<string, string>> entries = ReadTuningCache();
+	erase_if(entries, [&](const pair<string, string>& entry) { return entry.first == key; });
+	entries.push_back({key, GroupSizesToString(group_sizes)});
+	if (entries.size() > MAX_TUNING_CACHE_ENTRIES) {
+		entries.erase(entries.begin(), entries.end() - MAX_TUNING_CACHE_ENTRIES);
+	}
+
+	filesystem::path path = GetTuningCachePath();
+	filesystem::path temp = path;
+	temp += "." + to_string(hash<thread::id>()(this_thread::get_id()) ^ (size_t)chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+	{
+		ofstream file(temp);
+		for (auto& [entry_key, entry_sizes] : entries) {
+			file << entry_key << " " << entry_sizes << "\n";
+		}
+		if (!file) {
+			cerr << "Cannot write the tuning cache " << temp.string() << endl;
+			return;
+		}
+	}
+	error_code error;
+	filesystem::rename(temp, path, error);
+	if (error) {
+		filesystem::remove(temp, error);
+	}
+}
+
+unordered_map<int, vector<int>> GroupSizesByKernelIndex(Program* program, const unordered_map<size_t, vector<int>>& group_sizes) {
+	unordered_map<int, vector<int>> result;
+	for (int k = 0; k < program->kernels_.size(); k++) {
+		auto group_size = group_sizes.find(program->kernels_[k].root->signature);
+		if (group_size != group_sizes.end()) {
+			result[k] = group_size->second;
+		}
+	}
+	return result;
+}
+
+Program* TensorProgram::CompileVariant(const unordered_map<size_t, vector<int>>& group_sizes,
+                                       const unordered_map<int, vector<int>>& input_shapes) {
+	variant_irs.push_back(make_unique<IR>());
+	IR* variant_ir = variant_irs.back().get();
+	variant_ir->group_size_overrides = group_sizes;
+	variant_ir->specialized_input_shapes = input_shapes;
+
+	TraceProgram(evaluate_callback, variant_ir, program->program_name);
+	Program* variant = GenerateProgram(variant_ir);
+	variant->program_name = program->program_name;
+	Tensor::SetEvaluationContext(nullptr);
+
+	GenerateCode(variant);
+	LoadHostProgram(variant, program_id++);
+	CompileKernels(variant);
+
+	variant_programs.push_back(variant);
+	return variant;
+}
+
+string GetInputSignature(const vector<TFTensor*>& input) {
+	string signature;
+	for (TFTensor* tensor : input) {
+		signature += "[" + to_string((int)tensor->type);
+		for (size_t d = 0; d < tensor->dim; d++) {
+			signature += "," + to_string(tensor->shape[d]);
+		}
+		signature += "]";
+	}
+	return signature;
+}
+
+#define MAX_SPECIALIZED_PROGRAMS 16
+#define MAX_TUNED_BUCKETS 8
+
+Program* TensorProgram::GetProgramForInputs(const vector<TFTensor*>& input) {
+	if (specialize && input.size() == program->ir_->input_memory_map.size()) {
+		string signature = GetInputSignature(input);
+		if (!specialized_programs.contains(signature) && specialized_programs.size() < MAX_SPECIALIZED_PROGRAMS) {
+			unordered_map<int, vector<int>> input_shapes;
+			for (int i = 0; i < input.size(); i++) {
+				input_shapes[i] = vector<int>(input[i]->shape, input[i]->shape + input[i]->dim);
+			}
+			//keep using the generic program if the specialization fails to compile
+			try {
+				specialized_programs[signature] = CompileVariant({}, input_shapes);
+			} catch (const std::exception& e) {
+				cerr << "Failed to specialize " << program->program_name << " for " << signature << ": " << e.what() << endl;
+				Tensor::SetEvaluationContext(nullptr);
+				specialized_programs[signature] = nullptr;
+			}
+		}
+		if (specialized_programs.contains(signature) && specialized_programs[signature] != nullptr) {
+			return specialized_programs[signature];
+		}
+	}
+
+	if (tuned_programs.empty() && !autotune) {
+		return program;
+	}
+
+	string bucket = GetShapeBucket(input);
+	if (!tuned_programs.contains(bucket) && autotune && tuned_programs.size() < MAX_TUNED_BUCKETS) {
+		Tune(input, autotune_repeats);
+	}
+	if (tuned_programs.contains(bucket)) {
+		return tuned_programs[bucket];
+	}
+	return program;
+}
+
+unordered_map<int, vector<int>> TensorProgram::Tune(const vector<TFTensor*>& input, int repeats) {
+	if (current_backend == BackendType::CodeGen) {
+		throw std::runtime_error("Cannot tune a program with code generation backend");
+	}
+
+	string bucket = GetShapeBucket(input);
+	string key = GetTuningKey(program, bucket);
+
+	unordered_map<size_t, vector<int>> best_group_sizes;
+	if (LoadTunedGroupSizes(key, best_group_sizes)) {
+		tuned_programs[bucket] = CompileVariant(best_group_sizes);
+		return GroupSizesByKernelIndex(program, best_group_sizes);
+	}
+
+	//the program can modify its inputs, so run the variants on copies
+	vector<TFTensor*> input_copies;
+	for (TFTensor* tensor : input) {
+		vector<size_t> shape(tensor->shape, tensor->shape + tensor->dim);
+		input_copies.push_back(global_memory_manager->AllocateTensorWithData(shape, global_memory_manager->Readback(tensor), tensor->type));
+	}
+
+	//variant 0 uses the default group sizes, others use the same candidate for all kernels
+	int variant_count = (int)GetGroupSizeCandidates(1).size();
+	vector<Program*> variants = {program};
+	for (int v = 1; v < variant_count; v++) {
+		unordered_map<size_t, vector<int>> group_sizes;
+		for (auto& kernel : program->kernels_) {
+			int dims = (int)kernel.shape.size();
+			if (dims > 0) {
+				group_sizes[kernel.root->signature] = GetGroupSizeCandidates(dims)[v];
+			}
+		}
+		variants.push_back(CompileVariant(group_sizes));
+	}
+
+	//time the compiled variants, not the interpreted ones
+	UpgradeHostPrograms(true);
+
+	//the variants are timed with the profiler, the profile the user collected so far is restored afterwards
+	bool was_profiling = global_kernel_manager->profiling_enabled;
+	unordered_map<size_t, TimingStats> saved_kernel_stats = global_kernel_manager->kernel_stats;
+	map<Program*, map<string, TimingStats>> saved_region_stats = global_kernel_manager->region_stats;
+	//the kernels are matched between the variants by their signature, not by their position
+	unordered_map<size_t, double> best_time;
+	for (Program* variant : variants) {
+		for (auto& kernel : variant->kernels_) {
+			global_kernel_manager->kernel_stats.erase(kernel.kernel_id_);
+		}
+
+		//warmup run without timing
+		global_kernel_manager->profiling_enabled = false;
+		for (int r = 0; r <= repeats; r++) {
+			vector<TFTensor*> outputs = ExecuteProgram(variant, input_copies);
+			for (TFTensor* output : outputs) {
+				bool is_input = false;
+				for (TFTensor* copy : input_copies) {
+					is_input |= copy->buffer == output->buffer;
+				}
+				if (!is_input) {
+					global_memory_manager->DeallocateTensor(*output);
+				}
+			}
+			global_kernel_manager->profiling_enabled = true;
+		}
+
+		for (auto& kernel : variant->kernels_) {
+			if (!global_kernel_manager->kernel_stats.contains(kernel.kernel_id_)) {
+				continue;
+			}
+			TimingStats& stats = global_kernel_manager->kernel_stats[kernel.kernel_id_];
+			double time = stats.total_time / (double)stats.count;
+			size_t signature = kernel.root->signature;
+			if (!best_time.contains(signature) || time < best_time[signature]) {
+				best_time[signature] = time;
+				best_group_sizes[signature] = kernel.root->group_size;
+			}
+		}
+	}
+	global_kernel_manager->profiling_enabled = was_profiling;
+	global_kernel_manager->kernel_stats = saved_kernel_stats;
+	global_kernel_manager->region_stats = saved_region_stats;
+
+	for (TFTensor* copy : input_copies) {
+		global_memory_manager->DeallocateTensor(*copy);
+	}
+
+	//reuse a variant if it already has all the best group sizes
+	Program* tuned = nullptr;
+	for (Program* variant : variants) {
+		bool matches = true;
+		for (auto& kernel : variant->kernels_) {
+			auto best = best_group_sizes.find(kernel.root->signature);
+			matches &= best == best_group_sizes.end() || kernel.root->group_size == best->second;
+		}
+		if (matches) {
+			tuned = variant;
+			break;
+		}
+	}
+	if (tuned == nullptr) {
+		tuned = CompileVariant(best_group_sizes);
+	}
+
+	tuned_programs[bucket] = tuned;
+	SaveTunedGroupSizes(key, best_group_sizes);
+	return GroupSizesByKernelIndex(program, best_group_sizes);
 }
 
 string TensorProgram::PrintProperties() const { 
@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 #include <chrono>
+#include <memory>
 
 #include "Backend/Backend.h"
 #include "Compiler/KernelGen.h"
@@ -25,6 +26,15 @@ class TensorProgram {
 	bool debug = false;
 	float compile_time = 0.0f;
 	float external_compile_time = 0.0f;
+	float ir_compile_time = 0.0f;
+	float codegen_time = 0.0f;
+	float kernel_compile_time = 0.0f;
+
+	// when enabled, the first call with a new input signature compiles a version with constant input shapes
+	bool specialize = false;
+	// when enabled, the first call with a new shape bucket tunes the work group sizes
+	bool autotune = false;
+	int autotune_repeats = 10;
 
 	explicit TensorProgram(EvaluateFunction evaluate, string name) : evaluate_callback(std::move(evaluate)) {
 		CreateProgram(name);
@@ -34,11 +44,36 @@ class TensorProgram {
 	void CreateProgram(string name);
 
 	vector<TFTensor*> Evaluate(
-	    const vector<TFTensor*>& input) const;
+	    const vector<TFTensor*>& input);
+
+	/// <summary>
+	/// Time work group size variants of every kernel with the given inputs and use the fastest ones
+	/// for all inputs of the same shape bucket. The winners are persisted between sessions.
+	/// </summary>
+	/// <returns>The chosen group size for each kernel index</returns>
+	unordered_map<int, vector<int>> Tune(const vector<TFTensor*>& input, int repeats = 10);
 
 	string PrintProperties() const;
 
-	~TensorProgram() { delete program; }
+	~TensorProgram() {
+		ReleaseHostProgram(program);
+		delete program;
+		for (Program* variant : variant_programs) {
+			ReleaseHostProgram(variant);
+			delete variant;
+		}
+	}
+
+ private:
+	// separately compiled copies of the program with different work group sizes
+	vector<unique_ptr<IR>> variant_irs;
+	vector<Program*> variant_programs;
+	unordered_map<string, Program*> tuned_programs;
+	unordered_map<string, Program*> specialized_programs; // nullptr if the specialization failed
+
+	Program* CompileVariant(const unordered_map<size_t, vector<int>>& group_sizes,
+	                        const unordered_map<int, vector<int>>& input_shapes = {});
+	Program* GetProgramForInputs(const vector<TFTensor*>& input);
 };
 
 }  // namespace TensorFrost
\ No newline at end of file
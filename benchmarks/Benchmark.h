@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TensorFrost.h>
+
+namespace TensorFrost {
+
+using namespace std;
+
+struct BenchmarkOptions {
+	int warmup = 2;
+	int repeats = 10;
+	bool quick = false;
+	string filter;
+	string output;
+	string baseline;
+	double threshold = 0.1; // allowed relative slowdown against the baseline
+};
+
+struct BenchmarkResult {
+	string name;
+	string shape;
+	vector<pair<string, double>> values; // in the order they are written
+};
+
+inline BenchmarkOptions ParseBenchmarkOptions(int argc, char** argv, const string& usage, BenchmarkOptions options = {}) {
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto next = [&]() -> string {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("Missing value for " + arg);
+			}
+			return argv[++i];
+		};
+		if (arg == "--warmup") {
+			options.warmup = stoi(next());
+		} else if (arg == "--repeats") {
+			options.repeats = max(1, stoi(next()));
+		} else if (arg == "--quick") {
+			options.quick = true;
+		} else if (arg == "--filter") {
+			options.filter = next();
+		} else if (arg == "--output") {
+			options.output = next();
+		} else if (arg == "--baseline") {
+			options.baseline = next();
+		} else if (arg == "--threshold") {
+			options.threshold = stod(next());
+		} else {
+			cerr << usage << endl;
+			exit(arg == "--help" ? 0 : 2);
+		}
+	}
+	return options;
+}
+
+inline string ShapeToString(const vector<size_t>& shape) {
+	string result;
+	for (size_t i = 0; i < shape.size(); i++) {
+		result += (i == 0 ? "" : "x") + to_string(shape[i]);
+	}
+	return result;
+}
+
+inline double Median(vector<double> values) {
+	if (values.empty()) return 0.0;
+	sort(values.begin(), values.end());
+	size_t mid = values.size() / 2;
+	return values.size() % 2 == 0 ? 0.5 * (values[mid - 1] + values[mid]) : values[mid];
+}
+
+/// <summary>
+/// Run the function warmup + repeats times and return the durations of the timed runs in milliseconds
+/// </summary>
+inline vector<double> TimeRuns(const function<void()>& run, int warmup, int repeats) {
+	for (int i = 0; i < warmup; i++) {
+		run();
+	}
+	vector<double> times;
+	for (int i = 0; i < repeats; i++) {
+		auto start = chrono::high_resolution_clock::now();
+		run();
+		auto end = chrono::high_resolution_clock::now();
+		times.push_back(chrono::duration<double, milli>(end - start).count());
+	}
+	return times;
+}
+
+//deterministic pseudo random data, so that runs are comparable
+inline vector<uint32_t> RandomFloats(size_t count, uint32_t seed, float scale = 1.0f) {
+	vector<uint32_t> data(count);
+	uint32_t state = seed * 747796405u + 2891336453u;
+	for (size_t i = 0; i < count; i++) {
+		state = state * 1664525u + 1013904223u;
+		data[i] = AsUint(scale * (float)(state >> 8) / 16777216.0f);
+	}
+	return data;
+}
+
+inline vector<uint32_t> RandomInts(size_t count, uint32_t seed, uint32_t range) {
+	vector<uint32_t> data(count);
+	uint32_t state = seed * 747796405u + 2891336453u;
+	for (size_t i = 0; i < count; i++) {
+		state = state * 1664525u + 1013904223u;
+		data[i] = (state >> 8) % range;
+	}
+	return data;
+}
+
+//every result is written on its own line, so that baselines can be read back without a json parser
+inline void WriteBenchmarkJson(ostream& out, const string& suite, const vector<BenchmarkResult>& results) {
+	out << "{\n  \"suite\": \"" << EscapeJSON(suite) << "\",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		out << "    {\"name\": \"" << EscapeJSON(result.name) << "\", \"shape\": \"" << EscapeJSON(result.shape) << "\"";
+		for (auto& [key, value] : result.values) {
+			out << ", \"" << key << "\": " << value;
+		}
+		out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+inline void WriteBenchmarkResults(const BenchmarkOptions& options, const string& suite, const vector<BenchmarkResult>& results) {
+	if (options.output.empty()) {
+		WriteBenchmarkJson(cout, suite, results);
+		return;
+	}
+	ofstream file(options.output);
+	if (!file) {
+		throw std::runtime_error("Could not open " + options.output + " for writing");
+	}
+	WriteBenchmarkJson(file, suite, results);
+}
+
+inline string ExtractJsonString(const string& line, const string& key) {
+	string pattern = "\"" + key + "\": \"";
+	size_t start = line.find(pattern);
+	if (start == string::npos) return "";
+	start += pattern.size();
+	size_t end = line.find('"', start);
+	return line.substr(start, end - start);
+}
+
+inline bool ExtractJsonNumber(const string& line, const string& key, double& value) {
+	string pattern = "\"" + key + "\": ";
+	size_t start = line.find(pattern);
+	if (start == string::npos) return false;
+	value = stod(line.substr(start + pattern.size()));
+	return true;
+}
+
+/// <summary>
+/// Compare the given metric against a baseline written by a previous run
+/// </summary>
+/// <returns>The number of results that got worse by more than the threshold</returns>
+inline int CompareWithBaseline(const BenchmarkOptions& options, const vector<BenchmarkResult>& results, const string& metric) {
+	ifstream file(options.baseline);
+	if (!file) {
+		throw std::runtime_error("Could not open baseline " + options.baseline);
+	}
+	map<string, double> baseline;
+	string line;
+	while (getline(file, line)) {
+		double value;
+		if (ExtractJsonNumber(line, metric, value)) {
+			baseline[ExtractJsonString(line, "name") + " " + ExtractJsonString(line, "shape")] = value;
+		}
+	}
+
+	int regressions = 0;
+	for (const BenchmarkResult& result : results) {
+		auto it = baseline.find(result.name + " " + result.shape);
+		if (it == baseline.end()) continue;
+		for (auto& [key, value] : result.values) {
+			if (key != metric) continue;
+			double ratio = value / max(it->second, 1e-9);
+			bool regressed = ratio > 1.0 + options.threshold;
+			regressions += regressed;
+			cerr << (regressed ? "REGRESSION " : "ok ") << result.name << " [" << result.shape << "] " << metric << " "
+			     << it->second << " -> " << value << " (" << ratio << "x)" << endl;
+		}
+	}
+	return regressions;
+}
+
+}  // namespace TensorFrost
@@ -0,0 +1,222 @@
+#include <cmath>
+
+#include "Benchmark.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace TensorFrost;
+
+// Synthetic programs whose size grows linearly with the scale, so that the per pass times
+// show how every compiler pass scales with the graph size
+struct CompileWorkload {
+	string name;
+	function<Tensors(int)> build;
+};
+
+#define SUPERLINEAR_EXPONENT 1.5
+#define MIN_SCALING_PASS_TIME 1.0 // ms, faster passes are too noisy to estimate their scaling
+
+//the peak of the whole process so far, it never goes down between workloads
+static double PeakMemoryMB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return (double)counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (double)usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return (double)usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+static vector<CompileWorkload> CreateWorkloads() {
+	vector<CompileWorkload> workloads;
+
+	//forward and backward pass of a deep MLP
+	workloads.push_back({"mlp", [](int scale) -> Tensors {
+		int layers = 4 * scale;
+		Tensor& x = Tensor::Input({-1, 64}, TFType::Float);
+		Tensors weights, biases;
+		Tensor* h = &x;
+		for (int i = 0; i < layers; i++) {
+			weights.push_back(&Tensor::Input({64, 64}, TFType::Float));
+			biases.push_back(&Tensor::Input(vector<int>{64}, TFType::Float));
+			h = &Tensor::tanh(Tensor::Matmul(*h, *weights[i]) + *biases[i]);
+		}
+		Tensor& loss = Tensor::Sum(Tensor::Sum(*h * *h, -1), -1);
+		Tensors outputs = {&loss};
+		for (int i = 0; i < layers; i++) {
+			outputs.push_back(&Tensor::grad(loss, *weights[i]));
+			outputs.push_back(&Tensor::grad(loss, *biases[i]));
+		}
+		return outputs;
+	}});
+
+	//iterative stencil traced step by step, every step depends on the neighbors of the previous one
+	workloads.push_back({"unrolled_steps", [](int scale) -> Tensors {
+		int steps = 32 * scale;
+		Tensor& input = Tensor::Input(vector<int>{-1}, TFType::Float);
+		Tensors shape = input.GetShape();
+		Tensor& i = Tensor::Index(shape, 0);
+		Tensor* u = &input;
+		for (int step = 0; step < steps; step++) {
+			Tensor& left = Tensor::Load(*u, {&(i - Tensor::Constant(1))});
+			Tensor& right = Tensor::Load(*u, {&(i + Tensor::Constant(1))});
+			u = &(*u + Tensor::Constant(0.1f) * (left + right - Tensor::Constant(2.0f) * *u));
+		}
+		return {u};
+	}});
+
+	//constant trip count loops that are unrolled by the compiler
+	workloads.push_back({"unrolled_loops", [](int scale) -> Tensors {
+		int loops = 16 * scale;
+		Tensor& input = Tensor::Input({-1, -1}, TFType::Float);
+		Tensors shape = input.GetShape();
+		Tensor& i = Tensor::Index(shape, 0);
+		Tensor& j = Tensor::Index(shape, 1);
+		Tensor& output = Tensor::Constant(shape, 0.0f);
+		for (int l = 0; l < loops; l++) {
+			Tensor& acc = Tensor::Constant(shape, 0.0f);
+			Tensor::Loop(Tensor::Constant(0), Tensor::Constant(4), Tensor::Constant(1), [&](const Tensor& k) {
+				Tensor& value = Tensor::Load(input, {&i, &(j + k + Tensor::Constant(l))});
+				Tensor::Store(acc, acc + Tensor::sin(value) * Tensor::Constant(0.25f));
+			});
+			Tensor::Store(output, output + acc);
+		}
+		return {&output};
+	}});
+
+	//many independent reductions of different expressions
+	workloads.push_back({"reductions", [](int scale) -> Tensors {
+		int reductions = 32 * scale;
+		Tensor& input = Tensor::Input({-1, -1}, TFType::Float);
+		Tensor* total = nullptr;
+		for (int r = 0; r < reductions; r++) {
+			Tensor& value = Tensor::sin(input * Tensor::Constant(1.0f + 0.01f * (float)r));
+			Tensor& sum = r % 2 == 0 ? Tensor::Sum(value, -1) : Tensor::Max(value, -1);
+			total = total ? &(*total + sum) : &sum;
+		}
+		return {total};
+	}});
+
+	//autodiff over a long elementwise chain with thousands of nodes
+	workloads.push_back({"autodiff_chain", [](int scale) -> Tensors {
+		int links = 256 * scale;
+		Tensor& x = Tensor::Input(vector<int>{-1}, TFType::Float);
+		Tensor* y = &x;
+		for (int l = 0; l < links; l++) {
+			y = &(Tensor::sin(*y) * x + *y * Tensor::Constant(0.5f));
+		}
+		Tensor& loss = Tensor::Sum(*y, -1);
+		return {&loss, &Tensor::grad(loss, x)};
+	}});
+
+	return workloads;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions defaults;
+	defaults.warmup = 0;
+	defaults.repeats = 3;
+	BenchmarkOptions options = ParseBenchmarkOptions(argc, argv,
+		"usage: tensorfrost_compile_bench [--repeats N] [--quick] [--filter name] [--output file.json]\n"
+		"                                 [--baseline file.json] [--threshold 0.1]", defaults);
+
+	//only generate the code, the external compiler is not invoked
+	InitializeBackend(BackendType::CodeGen, "", CodeGenLang::None);
+
+	vector<int> scales = options.quick ? vector<int>{1, 2} : vector<int>{1, 2, 4, 8};
+	vector<BenchmarkResult> results;
+	for (CompileWorkload& workload : CreateWorkloads()) {
+		if (!options.filter.empty() && workload.name.find(options.filter) == string::npos) {
+			continue;
+		}
+
+		vector<int> node_counts;
+		vector<double> ir_times_per_scale;
+		vector<map<string, double>> pass_times_per_scale;
+		for (int scale : scales) {
+			vector<double> ir_times, codegen_times;
+			map<string, vector<double>> pass_times;
+			int nodes = 0, kernels = 0;
+			for (int repeat = 0; repeat < options.warmup + options.repeats; repeat++) {
+				TensorProgram program([&]() { return workload.build(scale); }, workload.name);
+				if (repeat < options.warmup) continue;
+				ir_times.push_back(program.ir_compile_time);
+				codegen_times.push_back(program.codegen_time);
+				//passes that run several times are summed up
+				map<string, double> repeat_pass_times;
+				for (auto& stats : program.ir.pass_stats) {
+					repeat_pass_times[stats.pass_name] += stats.duration;
+				}
+				for (auto& [pass, time] : repeat_pass_times) {
+					pass_times[pass].push_back(time);
+				}
+				nodes = program.ir.pass_stats.empty() ? 0 : program.ir.pass_stats.front().nodes_before;
+				kernels = (int)program.program->kernels_.size();
+			}
+
+			BenchmarkResult result = {workload.name, to_string(scale), {
+				{"ir_ms", Median(ir_times)},
+				{"codegen_ms", Median(codegen_times)},
+				{"nodes", (double)nodes},
+				{"kernels", (double)kernels},
+			}};
+			map<string, double> pass_medians;
+			for (auto& [pass, times] : pass_times) {
+				pass_medians[pass] = Median(times);
+				result.values.push_back({"pass_" + pass + "_ms", pass_medians[pass]});
+			}
+			cerr << workload.name << " [" << scale << "] " << nodes << " nodes, " << kernels << " kernels, IR "
+			     << result.values[0].second << " ms, codegen " << result.values[1].second << " ms" << endl;
+			results.push_back(result);
+			node_counts.push_back(nodes);
+			ir_times_per_scale.push_back(result.values[0].second);
+			pass_times_per_scale.push_back(pass_medians);
+		}
+
+		//compare the growth of every pass with the growth of the graph between the smallest and largest scale
+		if (scales.size() > 1 && node_counts.back() > node_counts.front()) {
+			double node_ratio = (double)node_counts.back() / (double)max(node_counts.front(), 1);
+			auto exponent = [&](double first, double last) { return log(last / first) / log(node_ratio); };
+			BenchmarkResult scaling = {workload.name, "scaling", {
+				{"ir_exponent", exponent(ir_times_per_scale.front(), ir_times_per_scale.back())},
+			}};
+			for (auto& [pass, time] : pass_times_per_scale.back()) {
+				double first = pass_times_per_scale.front()[pass];
+				if (first <= 0.0 || time < MIN_SCALING_PASS_TIME) continue;
+				double pass_exponent = exponent(first, time);
+				scaling.values.push_back({"pass_" + pass + "_exponent", pass_exponent});
+				if (pass_exponent > SUPERLINEAR_EXPONENT) {
+					cerr << "SUPERLINEAR " << workload.name << " " << pass << " scales as nodes^" << pass_exponent << endl;
+				}
+			}
+			results.push_back(scaling);
+		}
+	}
+
+	//reported once, attributing it to a single workload or scale would be wrong
+	results.push_back({"process", "all", {{"peak_rss_mb", PeakMemoryMB()}}});
+	cerr << "peak memory of the whole run " << results.back().values[0].second << " MB" << endl;
+
+	WriteBenchmarkResults(options, "tensorfrost_compile_bench", results);
+
+	if (!options.baseline.empty()) {
+		int regressions = CompareWithBaseline(options, results, "ir_ms");
+		if (regressions > 0) {
+			cerr << regressions << " workloads compile slower than the baseline by more than " << options.threshold * 100.0 << "%" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,196 @@
+#include "Benchmark.h"
+
+using namespace TensorFrost;
+
+// A benchmark case is compiled once with dynamic shapes and evaluated for every size of its sweep
+struct BenchmarkCase {
+	string name;
+	TensorProgram::EvaluateFunction build;
+	vector<vector<size_t>> sizes;
+	vector<vector<size_t>> quick_sizes;
+	function<vector<TFTensor*>(const vector<size_t>&)> inputs;
+	function<double(const vector<size_t>&)> bytes;
+	function<double(const vector<size_t>&)> flops;
+};
+
+static TFTensor* RandomTensor(const vector<size_t>& shape, uint32_t seed) {
+	return global_memory_manager->AllocateTensorWithData(shape, RandomFloats(GetLinearSize(shape), seed));
+}
+
+static double Elements(const vector<size_t>& size) {
+	return (double)GetLinearSize(size);
+}
+
+static vector<BenchmarkCase> CreateCases() {
+	vector<BenchmarkCase> cases;
+
+	cases.push_back({"elementwise",
+		[]() -> Tensors {
+			Tensor& a = Tensor::Input(vector<int>{-1}, TFType::Float);
+			Tensor& b = Tensor::Input(a.GetShape(), TFType::Float);
+			Tensor& c = a * b + Tensor::sin(a);
+			return {&c};
+		},
+		{{1 << 16}, {1 << 20}, {1 << 23}},
+		{{1 << 16}, {1 << 20}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1), RandomTensor(size, 2)};
+		},
+		[](const vector<size_t>& size) { return 12.0 * Elements(size); },
+		[](const vector<size_t>& size) { return 3.0 * Elements(size); }});
+
+	cases.push_back({"reduction",
+		[]() -> Tensors {
+			Tensor& a = Tensor::Input({-1, -1}, TFType::Float);
+			return {&Tensor::Sum(a, -1)};
+		},
+		{{1024, 1024}, {4096, 1024}, {64, 65536}},
+		{{256, 1024}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1)};
+		},
+		[](const vector<size_t>& size) { return 4.0 * (Elements(size) + (double)size[0]); },
+		[](const vector<size_t>& size) { return Elements(size); }});
+
+	cases.push_back({"scan",
+		[]() -> Tensors {
+			Tensor& a = Tensor::Input({-1, -1}, TFType::Float);
+			return {&Tensor::PrefixSum(a, -1)};
+		},
+		{{1024, 1024}, {64, 65536}},
+		{{256, 1024}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1)};
+		},
+		[](const vector<size_t>& size) { return 8.0 * Elements(size); },
+		[](const vector<size_t>& size) { return Elements(size); }});
+
+	cases.push_back({"matmul",
+		[]() -> Tensors {
+			Tensor& a = Tensor::Input({-1, -1}, TFType::Float);
+			Tensors shape = a.GetShape();
+			Tensor& b = Tensor::Input({shape[1], &Tensor::Constant(-1)}, TFType::Float);
+			return {&Tensor::Matmul(a, b)};
+		},
+		{{128}, {256}, {512}},
+		{{64}, {128}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor({size[0], size[0]}, 1), RandomTensor({size[0], size[0]}, 2)};
+		},
+		[](const vector<size_t>& size) { return 12.0 * (double)size[0] * (double)size[0]; },
+		[](const vector<size_t>& size) { return 2.0 * (double)size[0] * (double)size[0] * (double)size[0]; }});
+
+	cases.push_back({"conv3x3",
+		[]() -> Tensors {
+			Tensor& input = Tensor::Input({-1, -1}, TFType::Float);
+			Tensor& weights = Tensor::Input({3, 3}, TFType::Float);
+			Tensors shape = input.GetShape();
+			Tensor& i = Tensor::Index(shape, 0);
+			Tensor& j = Tensor::Index(shape, 1);
+			Tensor* result = nullptr;
+			for (int dy = 0; dy < 3; dy++) {
+				for (int dx = 0; dx < 3; dx++) {
+					Tensor& value = Tensor::Load(input, {&(i + Tensor::Constant(dy - 1)), &(j + Tensor::Constant(dx - 1))});
+					Tensor& term = value * Tensor::Load(weights, {&Tensor::Constant(dy), &Tensor::Constant(dx)});
+					result = result ? &(*result + term) : &term;
+				}
+			}
+			return {result};
+		},
+		{{512, 512}, {2048, 2048}},
+		{{256, 256}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1), RandomTensor({3, 3}, 2)};
+		},
+		[](const vector<size_t>& size) { return 8.0 * Elements(size); },
+		[](const vector<size_t>& size) { return 18.0 * Elements(size); }});
+
+	cases.push_back({"transpose",
+		[]() -> Tensors {
+			Tensor& a = Tensor::Input({-1, -1}, TFType::Float);
+			return {&Tensor::Transpose(a)};
+		},
+		{{512, 512}, {2048, 2048}, {256, 16384}},
+		{{256, 256}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1)};
+		},
+		[](const vector<size_t>& size) { return 8.0 * Elements(size); },
+		[](const vector<size_t>&) { return 0.0; }});
+
+	cases.push_back({"scatter",
+		[]() -> Tensors {
+			Tensor& values = Tensor::Input(vector<int>{-1}, TFType::Float);
+			Tensor& bins = Tensor::Input(values.GetShape(), TFType::Int);
+			Tensor& histogram = Tensor::Constant(vector<int>{256}, 0.0f);
+			Tensor& i = Tensor::Index(values.GetShape(), 0);
+			Tensor::ScatterAdd(histogram, Tensor::Load(values, {&i}), {&Tensor::Load(bins, {&i})});
+			return {&histogram};
+		},
+		{{1 << 16}, {1 << 20}, {1 << 22}},
+		{{1 << 16}},
+		[](const vector<size_t>& size) -> vector<TFTensor*> {
+			return {RandomTensor(size, 1), global_memory_manager->AllocateTensorWithData(size, RandomInts(size[0], 2, 256), TFType::Int)};
+		},
+		[](const vector<size_t>& size) { return 8.0 * Elements(size); },
+		[](const vector<size_t>& size) { return Elements(size); }});
+
+	return cases;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options = ParseBenchmarkOptions(argc, argv,
+		"usage: tensorfrost_bench [--warmup N] [--repeats N] [--quick] [--filter name] [--output file.json]\n"
+		"                         [--baseline file.json] [--threshold 0.1]");
+
+	InitializeBackend(BackendType::CPU, "", CodeGenLang::None);
+
+	vector<BenchmarkResult> results;
+	for (BenchmarkCase& bench : CreateCases()) {
+		if (!options.filter.empty() && bench.name.find(options.filter) == string::npos) {
+			continue;
+		}
+
+		TensorProgram program(bench.build, bench.name);
+		for (const vector<size_t>& size : options.quick ? bench.quick_sizes : bench.sizes) {
+			vector<TFTensor*> inputs = bench.inputs(size);
+			vector<TFTensor*> outputs;
+			auto run = [&]() {
+				for (TFTensor* output : outputs) {
+					global_memory_manager->DeallocateTensor(*output);
+				}
+				outputs = program.Evaluate(inputs);
+			};
+			double median = Median(TimeRuns(run, options.warmup, options.repeats));
+			for (TFTensor* tensor : outputs) {
+				global_memory_manager->DeallocateTensor(*tensor);
+			}
+			for (TFTensor* tensor : inputs) {
+				global_memory_manager->DeallocateTensor(*tensor);
+			}
+
+			double seconds = median * 1e-3;
+			BenchmarkResult result = {bench.name, ShapeToString(size), {
+				{"median_ms", median},
+				{"gb_per_s", bench.bytes(size) / seconds * 1e-9},
+				{"gflop_per_s", bench.flops(size) / seconds * 1e-9},
+				{"compile_ms", program.compile_time},
+				{"kernels", (double)program.program->kernels_.size()},
+			}};
+			cerr << bench.name << " [" << result.shape << "] " << median << " ms, " << result.values[1].second << " GB/s, "
+			     << result.values[2].second << " GFLOP/s" << endl;
+			results.push_back(result);
+		}
+	}
+
+	WriteBenchmarkResults(options, "tensorfrost_bench", results);
+
+	if (!options.baseline.empty()) {
+		int regressions = CompareWithBaseline(options, results, "median_ms");
+		if (regressions > 0) {
+			cerr << regressions << " benchmarks regressed by more than " << options.threshold * 100.0 << "%" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,620 @@
+#headless versions of the simulation, algorithm and ML examples with fixed sizes and synthetic data
+#usage: python workload_bench.py [--steps N] [--warmup N] [--quick] [--filter name] [--output file.json]
+#                                [--baseline file.json] [--threshold 0.1]
+import argparse
+import contextlib
+import io
+import json
+import sys
+import time
+
+import numpy as np
+import TensorFrost as tf
+
+def compile_quiet(function):
+    #tf.compile prints the program properties, they are reported in the results instead
+    with contextlib.redirect_stdout(io.StringIO()):
+        return tf.compile(function)
+
+# ---------------------------------------------------------------- wave (examples/Simulation/wave_simulation.ipynb)
+
+def wave_workload(quick):
+    N, M = (256, 256) if quick else (1024, 1024)
+
+    def WaveEq():
+        u = tf.input([-1, -1], tf.float32)
+        v = tf.input(u.shape, tf.float32)
+        i, j = u.indices
+        laplacian = u[i-1, j] + u[i+1, j] + u[i, j-1] + u[i, j+1] - u[i, j] * 4.0
+        force = laplacian - 0.1 * tf.sin(2.0*np.pi*u)
+        v_new = v + 0.2*force
+        u_new = u + 0.2*v_new
+        return [u_new, v_new]
+
+    wave = compile_quiet(WaveEq)
+
+    x, y = np.meshgrid(np.arange(M), np.arange(N))
+    state = [tf.tensor(np.exp(-((x-M/2)**2 + (y-N/2)**2)/100.0).astype(np.float32)), tf.tensor(np.zeros((N, M), np.float32))]
+
+    def step():
+        state[0], state[1] = wave(state[0], state[1])
+
+    return "%dx%d" % (N, M), [wave], step, lambda: state[0].numpy
+
+# ---------------------------------------------------------------- fluid (examples/Simulation/fluid_simulation.ipynb)
+
+boundary_thickness = 3
+
+def Bilinear(tex, x, y):
+    xi, yi = tf.floor(x), tf.floor(y)
+    xf, yf = x-xi, y-yi
+    xi, yi = tf.int(xi), tf.int(yi)
+    oxf, oyf = 1.0-xf, 1.0-yf
+    return tex[xi, yi]*oxf*oyf + tex[xi+1, yi]*xf*oyf + tex[xi, yi+1]*oxf*yf + tex[xi+1, yi+1]*xf*yf
+
+def CubicHermit(x):
+    x2 = x * x
+    x3 = x2 * x
+    return [-0.5 * x3 + x2 - 0.5 * x, 1.5 * x3 - 2.5 * x2 + 1.0, -1.5 * x3 + 2.0 * x2 + 0.5 * x, 0.5 * x3 - 0.5 * x2]
+
+def CubicInterp(tex, x, y):
+    xi, yi = tf.floor(x), tf.floor(y)
+    xf, yf = x-xi, y-yi
+    xi, yi = tf.int(xi), tf.int(yi)
+    wx = CubicHermit(xf)
+    wy = CubicHermit(yf)
+    valueY = 0.0
+    for j in range(-1, 3):
+        valueX = 0.0
+        for i in range(-1, 3):
+            valueX = valueX + tex[xi + i, yi + j] * wx[i + 1]
+        valueY = valueY + valueX * wy[j + 1]
+    return valueY
+
+def RK4Advection(vx, vy, dt):
+    i, j = vx.indices
+    x, y = tf.float(i), tf.float(j)
+    x1, y1 = x - vx*dt/2.0, y - vy*dt/2.0
+    vx1, vy1 = Bilinear(vx, x1, y1), Bilinear(vy, x1, y1)
+    x2, y2 = x - vx1*dt/2.0, y - vy1*dt/2.0
+    vx2, vy2 = Bilinear(vx, x2, y2), Bilinear(vy, x2, y2)
+    x3, y3 = x - vx2*dt, y - vy2*dt
+    vx3, vy3 = Bilinear(vx, x3, y3), Bilinear(vy, x3, y3)
+    x4, y4 = x - (vx + 2.0*vx1 + 2.0*vx2 + vx3)*dt/6.0, y - (vy + 2.0*vy1 + 2.0*vy2 + vy3)*dt/6.0
+    return x4, y4
+
+def SemiLagrange(vx, vy, density, dt):
+    x1, y1 = RK4Advection(vx, vy, dt)
+    vxb = Bilinear(vx, x1, y1)
+    vyb = Bilinear(vy, x1, y1)
+    densb = Bilinear(density, x1, y1)
+    thr0 = 0.97
+    thr1 = 1.03
+    vx = tf.clamp(CubicInterp(vx, x1, y1), tf.min(vxb*thr0, vxb*thr1), tf.max(vxb*thr0, vxb*thr1))
+    vy = tf.clamp(CubicInterp(vy, x1, y1), tf.min(vyb*thr0, vyb*thr1), tf.max(vyb*thr0, vyb*thr1))
+    density = tf.clamp(CubicInterp(density, x1, y1), tf.min(densb*thr0, densb*thr1), tf.max(densb*thr0, densb*thr1))
+    return vx, vy, density
+
+def Boundary(i, j):
+    N1, M1 = i.shape
+    return tf.select((i < boundary_thickness) | (i > N1-1-boundary_thickness) | (j < boundary_thickness) | (j > M1-1-boundary_thickness), 0.0, 1.0)
+
+def Jacobi(pressure, div, iterations):
+    i, j = pressure.indices
+    for it in range(iterations):
+        pressure = (pressure[i-1, j] + pressure[i+1, j] + pressure[i, j-1] + pressure[i, j+1] - div) / 4.0
+    return pressure
+
+def Restrict(field):
+    N1, M1 = field.shape
+    i, j = tf.indices([N1/2, M1/2])
+    i, j = 2*i, 2*j
+    return 0.25*(field[i, j] + field[i+1, j] + field[i, j+1] + field[i+1, j+1])
+
+def Prolong(field, orig):
+    i, j = orig.indices
+    return orig + Bilinear(field, tf.float(i)/2.0, tf.float(j)/2.0)
+
+def Residual(pressure, div):
+    i, j = pressure.indices
+    return Boundary(i, j) * (div - (pressure[i-1, j] + pressure[i+1, j] + pressure[i, j-1] + pressure[i, j+1] - 4.0*pressure))
+
+def VCycle(pressure, div):
+    pressure = Jacobi(pressure*0., div, 2)
+    res = Restrict(Residual(pressure, div))
+    pressure0 = Jacobi(tf.zeros(res.shape), 4.0*res, 8)
+    res1 = Restrict(Residual(pressure0, 4.0*res))
+    pressure1 = Jacobi(tf.zeros(res1.shape), 4.0*res1, 16)
+    pressure0 = Prolong(pressure1, pressure0)
+    pressure = Prolong(pressure0, pressure)
+    return Jacobi(pressure, div, 2)
+
+def fluid_workload(quick):
+    N, M = (128, 128) if quick else (512, 512)
+
+    def FluidStep():
+        vx = tf.input([N, M], tf.float32)
+        vy = tf.input([N, M], tf.float32)
+        pressure = tf.input([N, M], tf.float32)
+        density = tf.input([N, M], tf.float32)
+        params = tf.input([-1], tf.float32)
+
+        dt = params[0]
+        i, j = vx.indices
+        x, y = tf.float(i), tf.float(j)
+
+        vx, vy, density = SemiLagrange(vx, vy, density, dt)
+
+        #constant source in the middle of the domain instead of the mouse
+        source = tf.exp(-((y-0.5*float(M))**2.0 + (x-0.5*float(N))**2.0)/100.0)
+        vx = vx + source*params[1]
+        density = density + source*source
+
+        edge = Boundary(i, j)
+        vx = vx * 0.999
+        vy = vy * 0.999
+        density = tf.max(density * edge, 0.0) * 0.999
+
+        div = (vx[i+1, j] - vx[i-1, j] + vy[i, j+1] - vy[i, j-1]) / 2.0
+        pressure = VCycle(pressure, div)
+
+        vx = vx - (pressure[i+1, j] - pressure[i-1, j]) * edge
+        vy = vy - (pressure[i, j+1] - pressure[i, j-1]) * edge
+        return [vx, vy, pressure, density]
+
+    fluid = compile_quiet(FluidStep)
+
+    zeros = np.zeros((N, M), np.float32)
+    state = [tf.tensor(zeros), tf.tensor(zeros), tf.tensor(zeros), tf.tensor(zeros)]
+    params = tf.tensor(np.array([1.0, 0.1], np.float32))
+
+    def step():
+        state[:] = fluid(state[0], state[1], state[2], state[3], params)
+
+    return "%dx%d" % (N, M), [fluid], step, lambda: state[3].numpy
+
+# ---------------------------------------------------------------- n-body (examples/Simulation/n-body.ipynb)
+
+def nbody_workload(quick):
+    N = 256 if quick else 2048
+
+    def n_body():
+        X = tf.input([-1, 3], tf.float32)
+        N = X.shape[0]
+        V = tf.input([N, 3], tf.float32)
+        params = tf.input([-1], tf.float32)
+
+        sph_rad = params[0]
+        rest_density = params[1]
+        stiffness = params[2]
+        viscosity = params[3]
+        gravity = params[4]
+        time_step = params[5]
+
+        i, j, k = tf.indices([N, N, 3])
+        dx = X[j,k] - X[i,k]
+        dv = V[j,k] - V[i,k]
+
+        def sph_kernel(dist, rad):
+            return tf.exp(-(dist / rad)**2.0)
+
+        def pressure(rho):
+            return (rho - rest_density)
+
+        dist = tf.norm(dx)
+        rho = tf.sum(sph_kernel(dist, sph_rad), axis=1)
+
+        d2 = tf.unsqueeze(tf.sum(dx**2.0))
+        dist = tf.sqrt(d2 + 1e-4)
+        Fg = - tf.grad(gravity / dist, dx)
+        weight = sph_kernel(dist, sph_rad)
+        weightgrad = tf.grad(weight, dx)
+        dvdotdx = tf.unsqueeze(tf.dot(dv, dx)) / (tf.sqrt(d2) + 1e-5)
+        Fvisc = - viscosity * dvdotdx * weightgrad
+        Fsph = stiffness * 0.5 * (pressure(rho[i]) + pressure(rho[j])) * weightgrad
+        dist2 = (tf.sqrt(d2) + 1e-8)
+        Fspike = - 250.0 * sph_kernel(dist, 1.0*sph_rad) * dx / (dist2*dist2)
+        Fij = tf.select(i == j, 0.0, Fg + Fsph + Fvisc + Fspike)
+        Fi = tf.sum(Fij, axis=1)
+
+        Vnew = V + Fi * time_step
+        Xnew = X + Vnew * time_step
+        return [Xnew, Vnew]
+
+    nbody = compile_quiet(n_body)
+
+    rng = np.random.default_rng(0)
+    state = [tf.tensor(rng.uniform(-0.5, 0.5, (N, 3)).astype(np.float32)), tf.tensor(np.zeros((N, 3), np.float32))]
+    params = tf.tensor(np.array([0.015, 0.5, 20.0, 100.0, 1.5, 0.0001], np.float32))
+
+    def step():
+        state[0], state[1] = nbody(state[0], state[1], params)
+
+    return str(N), [nbody], step, lambda: state[0].numpy
+
+# ---------------------------------------------------------------- fft (examples/Algorithms/fft.ipynb)
+
+def fft_workload(quick):
+    N = 1 << (12 if quick else 18)
+
+    def FFT():
+        SignalRe = tf.input([-1], tf.float32)
+        SignalIm = tf.input([-1], tf.float32)
+        N = SignalRe.shape[0]
+
+        it_num = tf.int(tf.floor(tf.log2(tf.float(N))))-1
+
+        def reverseBits(num, bits):
+            reverse_num = tf.reversebits(tf.uint(num)) >> (32 - bits)
+            return tf.int(reverse_num) + ((num >> bits) << bits)
+
+        def getIndexPair(i, it):
+            k1 = reverseBits(2*i, it+1)
+            k2 = k1 + (1 << it)
+            return [k1, k2]
+
+        Output = tf.buffer([N, 2], tf.float32)
+
+        with tf.loop(0, it_num+1) as it:
+            with tf.kernel([N/2]) as i:
+                k1, k2 = getIndexPair(i, tf.select(it == 0, it_num, it))
+                Re1 = tf.select(it == 0, SignalRe[k2], Output[k2, 0])
+                Im1 = tf.select(it == 0, SignalIm[k2], Output[k2, 1])
+                Re2 = tf.select(it == 0, SignalRe[k1], Output[k1, 0])
+                Im2 = tf.select(it == 0, SignalIm[k1], Output[k1, 1])
+
+                k1, k2 = getIndexPair(i, it)
+                k3 = (k1 & ((1 << it) - 1)) * (1 << (it_num - it))
+                alpha = - 2 * np.pi * tf.float(k3) / tf.float(N)
+                C, S = tf.cos(alpha), tf.sin(alpha)
+                m = C * Re1 - S * Im1
+                n = S * Re1 + C * Im1
+                Output[k1, 0] = Re2 + m
+                Output[k1, 1] = Im2 + n
+                Output[k2, 0] = Re2 - m
+                Output[k2, 1] = Im2 - n
+
+        return Output
+
+    fft = compile_quiet(FFT)
+
+    t = np.arange(N)
+    re = tf.tensor((np.sin(10 * 2 * np.pi * t / N) + np.cos(20 * 2 * np.pi * t / N)).astype(np.float32))
+    im = tf.tensor(np.zeros(N, np.float32))
+    result = [None]
+
+    def step():
+        result[0] = fft(re, im)
+
+    return str(N), [fft], step, lambda: result[0].numpy
+
+# ---------------------------------------------------------------- qr (examples/Algorithms/qr.ipynb)
+
+def qr_workload(quick):
+    N = 64 if quick else 512
+
+    def QRDecomposition():
+        A = tf.input([-1, -1], tf.float32)
+
+        m, n = A.shape
+        Q = tf.zeros([m, n])
+        R = tf.zeros([n, n])
+        j = tf.index(0, [m])
+
+        with tf.loop(n-1) as i:
+            R[i, i] = tf.norm(A[j, i])
+            Q[j, i] = A[j, i] / R[i, i]
+
+            p, k = tf.index_grid([0, i + 1], [m, n])
+            t, = tf.index_grid([i+1], [n])
+            R[i, t] = tf.sum(Q[p, i] * A[p, k], axis=0)
+            A[p, k] -= Q[p, i] * R[i, k]
+
+        R[n-1, n-1] = tf.norm(A[j, n-1])
+        Q[j, n-1] = A[j, n-1] / R[n-1, n-1]
+        return [Q, R]
+
+    qr = compile_quiet(QRDecomposition)
+
+    #the decomposition works in place on its input, so every step uploads a fresh matrix
+    A = np.random.default_rng(0).random((N, N)).astype(np.float32)
+    result = [None]
+
+    def step():
+        result[0] = qr(tf.tensor(A))
+
+    return "%dx%d" % (N, N), [qr], step, lambda: result[0][1].numpy
+
+# ---------------------------------------------------------------- scan (examples/Algorithms/scan.ipynb)
+
+def scan_workload(quick):
+    N = 1 << (16 if quick else 22)
+
+    def Scan():
+        data = tf.input([-1], tf.int32)
+        N = data.shape[0]
+        group_size = 128
+        groups = (N + group_size - 1) / group_size
+
+        gid, eid = tf.indices([groups, group_size])
+        grouped = tf.select(gid * group_size + eid < N, data[gid * group_size + eid], 0)
+        group_scan = tf.prefix_sum(grouped)
+
+        gid, = tf.indices([groups])
+        groups_scan = tf.prefix_sum(group_scan[gid, group_size - 1])
+
+        fid, = tf.indices([N])
+        gid = fid / group_size
+        eid = fid - gid * group_size
+        return group_scan[gid, eid] + tf.select(gid == 0, 0, groups_scan[gid - 1])
+
+    scan = compile_quiet(Scan)
+
+    data = tf.tensor(np.random.default_rng(0).integers(0, 10, N, dtype=np.int32))
+    result = [None]
+
+    def step():
+        result[0] = scan(data)
+
+    return str(N), [scan], step, lambda: result[0].numpy
+
+# ---------------------------------------------------------------- bitonic (examples/Algorithms/bitonic.ipynb)
+
+def bitonic_workload(quick):
+    N = 1 << (12 if quick else 18)
+
+    def BitonicSort():
+        input = tf.input([-1, 2], tf.int32)
+        N = input.shape[0]
+
+        output = tf.buffer([N, 2], tf.int32)
+        i, j = output.indices
+        output[i, j] = input[i, j]
+
+        log2N = tf.ceil(tf.log2(tf.float(N)))
+        Nround = tf.int(tf.exp2(log2N))
+        steps = tf.int(log2N*(log2N + 1.0)/2.0)
+
+        sort_id = tf.indices([Nround/2])[0]
+        def sortingIteration(step):
+            def getBitonicElementPair(id, step):
+                j = tf.floor(tf.sqrt(tf.float(2*step) + 1.0) - 0.5)
+                n = tf.round(tf.float(step) - 0.5*j*(j+1.0))
+                B = tf.int(tf.round(tf.exp2(j-n)))
+                mask = tf.select(n < 0.5, 2*B - 1, B)
+                e1 = id%B + 2*B*(id/B)
+                e2 = e1 ^ mask
+                return e1, e2
+
+            e1, e2 = getBitonicElementPair(sort_id, step)
+
+            def sort():
+                key1, key2 = output[e1, 0], output[e2, 0]
+                val1, val2 = output[e1, 1], output[e2, 1]
+
+                def swap():
+                    output[e1, 0] = key2
+                    output[e2, 0] = key1
+                    output[e1, 1] = val2
+                    output[e2, 1] = val1
+
+                tf.if_cond(key1 > key2, swap)
+
+            tf.if_cond((e1 < N) & (e2 < N), sort)
+
+        tf.loop(sortingIteration, 0, steps, 1)
+        return output
+
+    sort = compile_quiet(BitonicSort)
+
+    keys = np.random.default_rng(0).integers(0, 1 << 20, N, dtype=np.int32)
+    data = tf.tensor(np.column_stack((keys, np.arange(N, dtype=np.int32))))
+    result = [None]
+
+    def step():
+        result[0] = sort(data)
+
+    return str(N), [sort], step, lambda: result[0].numpy
+
+# ---------------------------------------------------------------- mnist training step (examples/ML/module.py)
+
+def GELU(X):
+    return 0.5*X*(1.0 + tf.tanh(np.sqrt(2.0/np.pi) * (X + 0.044715 * (X * X * X))))
+
+def log_softmax(X):
+    X = X - tf.unsqueeze(tf.max(X))
+    return X - tf.log(tf.unsqueeze(tf.sum(tf.exp(X))))
+
+class MNIST_net(tf.Module):
+    def __init__(self, input_resolution = 28, output_size = 10):
+        super().__init__()
+        self.resolution = input_resolution
+        self.kernel_size = 5
+        self.res1 = (self.resolution - self.kernel_size + 1)
+        self.res1p = self.res1 // 2
+        self.res2 = (self.res1p - self.kernel_size + 1)
+        self.res2p = self.res2 // 2
+        self.kernels1 = 16
+        self.kernels2 = 64
+        self.layer1 = 256
+        self.conv1 = tf.Parameter([self.kernels1, 1, self.kernel_size, self.kernel_size], tf.float32, random_scale = np.sqrt(0.1 / (self.kernel_size ** 2 * 1)))
+        self.conv1_bias = tf.Parameter([self.kernels1], tf.float32, random_scale = 0.0)
+        self.conv2 = tf.Parameter([self.kernels2, self.kernels1, self.kernel_size, self.kernel_size], tf.float32, random_scale = np.sqrt(0.1 / (self.kernel_size ** 2 * self.kernels1)))
+        self.conv2_bias = tf.Parameter([self.kernels2], tf.float32, random_scale = 0.0)
+        self.fc1 = tf.Parameter([self.kernels2 * self.res2p ** 2, self.layer1], tf.float32)
+        self.fc1_bias = tf.Parameter([self.layer1], tf.float32, random_scale = 0.0)
+        self.fc2 = tf.Parameter([self.layer1, output_size], tf.float32)
+        self.fc2_bias = tf.Parameter([output_size], tf.float32, random_scale = 0.0)
+
+    def conv2d(self, X, W, b):
+        bi, wi, hi, cout, cin, it = tf.indices([X.shape[0], X.shape[1] - W.shape[2] + 1, X.shape[2] - W.shape[3] + 1, W.shape[0], W.shape[1], W.shape[2] * W.shape[3]])
+        i, j = it%W.shape[2], it/W.shape[2]
+        conv = tf.sum(tf.sum(X[bi, wi + i, hi + j, cin] * W[cout, cin, i, j]))
+        return conv + b
+
+    def max_pool2d(self, X):
+        bi, wi, hi, ci, i, j = tf.indices([X.shape[0], X.shape[1] / 2, X.shape[2] / 2, X.shape[3], 2, 2])
+        return tf.max(tf.max(X[bi, 2 * wi + i, 2 * hi + j, ci]))
+
+    def forward(self, X):
+        X = tf.reshape(X, [X.shape[0], self.resolution, self.resolution, 1])
+        X = GELU(self.max_pool2d(self.conv2d(X, self.conv1, self.conv1_bias)))
+        X = GELU(self.max_pool2d(self.conv2d(X, self.conv2, self.conv2_bias)))
+        X = tf.reshape(X, [X.shape[0], self.fc1.shape[0]])
+        X = GELU(X @ self.fc1 + self.fc1_bias)
+        return X @ self.fc2 + self.fc2_bias
+
+    def loss(self, X, Y):
+        Yhat = self.forward(X)
+        return tf.mean(tf.sum(-Y * log_softmax(Yhat)))
+
+def mnist_workload(quick):
+    batch_size = 16 if quick else 128
+    samples = 8 * batch_size
+    lr = 0.0005
+
+    def OptimizerStep():
+        X = tf.input([-1, -1], tf.float32)
+        Y = tf.input([-1, 10], tf.float32)
+
+        info = tf.input([-1], tf.float32)
+        offset = tf.int(info[0])
+        batch_size = tf.int(info[1])
+        learning_rate = info[2]
+
+        model = MNIST_net()
+        opt = tf.optimizers.adam(model, learning_rate)
+        opt.initialize_input()
+
+        i, j = tf.indices([batch_size, X.shape[1]])
+        Xbatch = X[i + offset, j]
+        i, j = tf.indices([batch_size, Y.shape[1]])
+        Ybatch = Y[i + offset, j]
+
+        L = opt.step(Xbatch, Ybatch)
+
+        params = opt.parameters()
+        params.append(L)
+        return params
+
+    train_step = compile_quiet(OptimizerStep)
+
+    model = MNIST_net()
+    opt = tf.optimizers.adam(model, lr)
+    opt.initialize_parameters()
+
+    #random images with random one-hot labels
+    rng = np.random.default_rng(0)
+    Y = np.zeros((samples, 10), np.float32)
+    Y[np.arange(samples), rng.integers(0, 10, samples)] = 1.0
+    Xtf = tf.tensor(rng.random((samples, 28 * 28)).astype(np.float32))
+    Ytf = tf.tensor(Y)
+    iteration = [0]
+    result = [None]
+
+    def step():
+        offset = (iteration[0] % (samples // batch_size)) * batch_size
+        result[0] = train_step(Xtf, Ytf, [offset, batch_size, lr], opt)
+        opt.update_parameters(result[0][:-1])
+        iteration[0] += 1
+
+    return str(batch_size), [train_step], step, lambda: result[0][-1].numpy
+
+WORKLOADS = [
+    ("wave", wave_workload),
+    ("fluid", fluid_workload),
+    ("nbody", nbody_workload),
+    ("fft", fft_workload),
+    ("qr", qr_workload),
+    ("scan", scan_workload),
+    ("bitonic", bitonic_workload),
+    ("mnist_train", mnist_workload),
+]
+
+# ---------------------------------------------------------------- runner
+
+def run_workload(name, create, args):
+    compile_start = time.perf_counter()
+    shape, programs, step, sync = create(args.quick)
+    compile_time = (time.perf_counter() - compile_start) * 1000.0
+
+    for i in range(args.warmup):
+        step()
+    sync()
+
+    start = time.perf_counter()
+    for i in range(args.steps):
+        step()
+    sync() #the readback waits for all the queued work
+    elapsed = time.perf_counter() - start
+
+    result = {"name": name, "shape": shape}
+    result["ms_per_step"] = elapsed * 1000.0 / args.steps
+    result["steps_per_s"] = args.steps / elapsed
+    result["compile_ms"] = compile_time
+    result["ir_compile_ms"] = sum(program.compile_stats()["ir_compile_time_ms"] for program in programs)
+    for key in ["kernels", "intermediate_buffers", "host_readbacks", "host_writes"]:
+        result[key] = sum(program.properties()[key] for program in programs)
+    return result
+
+def write_results(out, results):
+    #same layout as the C++ benchmarks, one result per line
+    out.write('{\n  "suite": "tensorfrost_workloads",\n  "results": [\n')
+    for i, result in enumerate(results):
+        out.write("    " + json.dumps(result) + ("," if i + 1 < len(results) else "") + "\n")
+    out.write("  ]\n}\n")
+
+def compare_with_baseline(results, baseline_path, threshold, metric = "ms_per_step"):
+    with open(baseline_path) as file:
+        baseline = {(result["name"], result["shape"]): result for result in json.load(file)["results"]}
+
+    regressions = 0
+    for result in results:
+        reference = baseline.get((result["name"], result["shape"]))
+        if reference is None or metric not in reference:
+            continue
+        ratio = result[metric] / max(reference[metric], 1e-9)
+        regressed = ratio > 1.0 + threshold
+        regressions += regressed
+        changed = ["%s %g -> %g" % (key, reference[key], result[key]) for key in ["kernels", "intermediate_buffers"] if key in reference and reference[key] != result[key]]
+        print("%s%s [%s] %s %g -> %g (%.3fx)%s" % ("REGRESSION " if regressed else "ok ", result["name"], result["shape"], metric,
+              reference[metric], result[metric], ratio, ", " + ", ".join(changed) if changed else ""), file=sys.stderr)
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description="Headless end-to-end benchmarks of the example workloads on the CPU backend")
+    parser.add_argument("--steps", type=int, default=20, help="number of timed steps")
+    parser.add_argument("--warmup", type=int, default=2, help="number of untimed steps after compilation")
+    parser.add_argument("--quick", action="store_true", help="use small problem sizes")
+    parser.add_argument("--filter", default="", help="only run workloads whose name contains this string")
+    parser.add_argument("--output", default="", help="write the results to this file instead of stdout")
+    parser.add_argument("--baseline", default="", help="compare the step times against a previous result")
+    parser.add_argument("--threshold", type=float, default=0.1, help="allowed relative slowdown against the baseline")
+    args = parser.parse_args()
+    args.steps = max(1, args.steps)
+
+    tf.initialize(tf.cpu)
+
+    results = []
+    for name, create in WORKLOADS:
+        if args.filter not in name:
+            continue
+        result = run_workload(name, create, args)
+        print("%s [%s] %.3f ms/step, %.1f steps/s, %d kernels, %d intermediate buffers, compiled in %.0f ms" % (name, result["shape"],
+              result["ms_per_step"], result["steps_per_s"], result["kernels"], result["intermediate_buffers"], result["compile_ms"]), file=sys.stderr)
+        results.append(result)
+
+    if args.output:
+        with open(args.output, "w") as file:
+            write_results(file, results)
+    else:
+        write_results(sys.stdout, results)
+
+    if args.baseline:
+        regressions = compare_with_baseline(results, args.baseline, args.threshold)
+        if regressions > 0:
+            print("%d workloads regressed by more than %g%%" % (regressions, args.threshold * 100.0), file=sys.stderr)
+            sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,226 @@
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <TensorFrost.h>
+
+using namespace TensorFrost;
+using namespace std;
+
+// Regression tests that compile small programs and compare their results with plain C++,
+// every test throws on a mismatch. Pass a name to only run the tests that contain it.
+struct TestCase {
+	string name;
+	function<void()> run;
+};
+
+#define TEST_TOLERANCE 1e-4
+
+static void ExpectClose(const vector<float>& result, const vector<float>& expected, const string& what) {
+	if (result.size() != expected.size()) {
+		throw std::runtime_error(what + ": got " + to_string(result.size()) + " values, expected " + to_string(expected.size()));
+	}
+	for (size_t i = 0; i < result.size(); i++) {
+		if (!(abs(result[i] - expected[i]) <= TEST_TOLERANCE * max(1.0f, abs(expected[i])))) {
+			throw std::runtime_error(what + ": value " + to_string(i) + " is " + to_string(result[i]) + ", expected " + to_string(expected[i]));
+		}
+	}
+}
+
+static TFTensor* FloatTensor(const vector<size_t>& shape, const vector<float>& values) {
+	vector<uint32_t> data(values.size());
+	for (size_t i = 0; i < values.size(); i++) {
+		data[i] = AsUint(values[i]);
+	}
+	return global_memory_manager->AllocateTensorWithData(shape, data);
+}
+
+static vector<float> ReadFloats(TFTensor* tensor) {
+	vector<uint32_t> data = global_memory_manager->Readback(tensor);
+	vector<float> values(data.size());
+	for (size_t i = 0; i < data.size(); i++) {
+		values[i] = AsFloat(data[i]);
+	}
+	return values;
+}
+
+//small integers, so that the sums are exact in any order
+static vector<float> TestValues(size_t count) {
+	vector<float> values(count);
+	for (size_t i = 0; i < count; i++) {
+		values[i] = (float)((i * 37) % 19) - 9.0f;
+	}
+	return values;
+}
+
+//sums every row of x weighted by the column index, the accumulator is loaded and stored inside a loop with a dynamic trip count
+static Tensors LoopAccumulation() {
+	Tensor& x = Tensor::Input({-1, -1}, TFType::Float);
+	Tensors shape = x.GetShape();
+	Tensor& i = Tensor::Index({shape[0]}, 0);
+	Tensor& acc = Tensor::Constant({shape[0]}, 0.0f);
+	Tensor::Loop(Tensor::Constant(0), *shape[1], Tensor::Constant(1), [&](const Tensor& k) {
+		Tensor& value = Tensor::Load(x, {&i, &k});
+		Tensor::Store(acc, acc + value * Tensor::tofloat(k));
+	});
+	return {&acc};
+}
+
+static vector<float> LoopAccumulationReference(const vector<float>& x, size_t rows, size_t cols) {
+	vector<float> acc(rows, 0.0f);
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t k = 0; k < cols; k++) {
+			acc[i] += x[i * cols + k] * (float)k;
+		}
+	}
+	return acc;
+}
+
+//the accumulator decays in the inner loop and is stored in both loops
+static Tensors NestedLoopDecay() {
+	Tensor& x = Tensor::Input({-1, -1}, TFType::Float);
+	Tensors shape = x.GetShape();
+	Tensor& i = Tensor::Index({shape[0]}, 0);
+	Tensor& acc = Tensor::Constant({shape[0]}, 1.0f);
+	Tensor::Loop(Tensor::Constant(0), *shape[1], Tensor::Constant(1), [&](const Tensor& k) {
+		Tensor& value = Tensor::Load(x, {&i, &k});
+		Tensor::Loop(Tensor::Constant(0), Tensor::Constant(3), Tensor::Constant(1), [&](const Tensor& j) {
+			Tensor::Store(acc, acc * Tensor::Constant(0.5f) + value * Tensor::tofloat(j));
+		});
+		Tensor::Store(acc, acc - Tensor::Constant(0.25f));
+	});
+	return {&acc};
+}
+
+//runs the program in the interpreter first, then again once the native version is compiled
+static void ExpectInterpreterMatchesCPU(const function<Tensors()>& build, const string& name, const vector<TFTensor*>& inputs) {
+	tiered_compilation = true;
+	TensorProgram program(build, name);
+	tiered_compilation = false;
+
+	vector<vector<float>> interpreted;
+	for (TFTensor* output : program.Evaluate(inputs)) {
+		interpreted.push_back(ReadFloats(output));
+	}
+	UpgradeHostPrograms(true);
+	vector<TFTensor*> compiled = program.Evaluate(inputs);
+	for (size_t i = 0; i < compiled.size(); i++) {
+		ExpectClose(interpreted[i], ReadFloats(compiled[i]), name + " output " + to_string(i));
+	}
+}
+
+#define HISTOGRAM_BINS 16
+
+//counts and sums the values per bin, the bins are few compared to the dispatch so the CPU backend scatters into per worker copies
+static Tensors ScatterHistogram() {
+	Tensor& x = Tensor::Input(vector<int>{-1}, TFType::Float);
+	Tensor& i = Tensor::Index(x.GetShape(), 0);
+	Tensor& bin = i % Tensor::Constant(HISTOGRAM_BINS);
+	Tensor& counts = Tensor::Constant(vector<int>{HISTOGRAM_BINS}, 0);
+	Tensor& sums = Tensor::Constant(vector<int>{HISTOGRAM_BINS}, 0.0f);
+	Tensor::ScatterAdd(counts, Tensor::Constant(1), {&bin});
+	Tensor::ScatterAdd(sums, x, {&bin});
+	return {&counts, &sums};
+}
+
+//two layers with their weight gradients, the cheap activations are recomputed in the backward pass unless it is disabled
+static Tensors TwoLayerGradients(bool checkpoint) {
+	Tensor& x = Tensor::Input({-1, 8}, TFType::Float);
+	Tensor& w1 = Tensor::Input({8, 8}, TFType::Float);
+	Tensor& w2 = Tensor::Input({8, 8}, TFType::Float);
+	Tensor& h1 = Tensor::tanh(Tensor::Matmul(x, w1));
+	if (checkpoint) h1.Checkpoint();
+	Tensor& h2 = Tensor::tanh(Tensor::Matmul(h1, w2)) * Tensor::sin(h1) + Tensor::exp(-h1 * h1);
+	Tensor& loss = Tensor::Sum(Tensor::Sum(h2 * h2, -1), -1);
+	return {&loss, &Tensor::grad(loss, w1), &Tensor::grad(loss, w2), &Tensor::grad(loss, x)};
+}
+
+static vector<vector<float>> EvaluateTwoLayerGradients(bool checkpoint, bool rematerialize) {
+	rematerialize_forward_values = rematerialize;
+	TensorProgram program([checkpoint]() { return TwoLayerGradients(checkpoint); }, "two_layer_gradients");
+	rematerialize_forward_values = true;
+
+	vector<float> x = TestValues(32 * 8), w1 = TestValues(8 * 8 + 3), w2 = TestValues(8 * 8 + 5);
+	for (float& value : x) value *= 0.05f;
+	for (float& value : w1) value *= 0.03f;
+	for (float& value : w2) value *= 0.04f;
+	w1.resize(8 * 8);
+	w2.resize(8 * 8);
+	vector<TFTensor*> outputs = program.Evaluate({FloatTensor({32, 8}, x), FloatTensor({8, 8}, w1), FloatTensor({8, 8}, w2)});
+
+	vector<vector<float>> results;
+	for (TFTensor* output : outputs) {
+		results.push_back(ReadFloats(output));
+	}
+	return results;
+}
+
+static vector<TestCase> CreateTests() {
+	vector<TestCase> tests;
+
+	tests.push_back({"loop_accumulation", []() {
+		size_t rows = 300, cols = 70;
+		vector<float> x = TestValues(rows * cols);
+		TensorProgram program(LoopAccumulation, "loop_accumulation");
+		vector<TFTensor*> outputs = program.Evaluate({FloatTensor({rows, cols}, x)});
+		ExpectClose(ReadFloats(outputs[0]), LoopAccumulationReference(x, rows, cols), "accumulator");
+	}});
+
+	tests.push_back({"interpreted_loops", []() {
+		size_t rows = 300, cols = 70;
+		TFTensor* x = FloatTensor({rows, cols}, TestValues(rows * cols));
+		ExpectInterpreterMatchesCPU(LoopAccumulation, "interpreted_loop_accumulation", {x});
+		ExpectInterpreterMatchesCPU(NestedLoopDecay, "interpreted_nested_loop_decay", {x});
+	}});
+
+	tests.push_back({"scatter_histogram", []() {
+		size_t count = 100000;
+		vector<float> x = TestValues(count);
+		vector<float> counts(HISTOGRAM_BINS, 0.0f), sums(HISTOGRAM_BINS, 0.0f);
+		for (size_t i = 0; i < count; i++) {
+			counts[i % HISTOGRAM_BINS] += 1.0f;
+			sums[i % HISTOGRAM_BINS] += x[i];
+		}
+		TensorProgram program(ScatterHistogram, "scatter_histogram");
+		vector<TFTensor*> outputs = program.Evaluate({FloatTensor({count}, x)});
+		vector<uint32_t> result_counts = global_memory_manager->Readback(outputs[0]);
+		vector<float> counted(result_counts.begin(), result_counts.end());
+		ExpectClose(counted, counts, "counts");
+		ExpectClose(ReadFloats(outputs[1]), sums, "sums");
+	}});
+
+	tests.push_back({"rematerialized_gradients", []() {
+		for (bool checkpoint : {false, true}) {
+			vector<vector<float>> kept = EvaluateTwoLayerGradients(checkpoint, false);
+			vector<vector<float>> recomputed = EvaluateTwoLayerGradients(checkpoint, true);
+			for (size_t i = 0; i < kept.size(); i++) {
+				ExpectClose(recomputed[i], kept[i], string(checkpoint ? "checkpointed" : "automatic") + " output " + to_string(i));
+			}
+		}
+	}});
+
+	return tests;
+}
+
+int main(int argc, char** argv) {
+	string filter = argc > 1 ? argv[1] : "";
+	InitializeBackend(BackendType::CPU, "", CodeGenLang::None);
+
+	int failed = 0;
+	for (TestCase& test : CreateTests()) {
+		if (!filter.empty() && test.name.find(filter) == string::npos) {
+			continue;
+		}
+		try {
+			test.run();
+			cerr << "ok " << test.name << endl;
+		} catch (const std::exception& e) {
+			cerr << "FAILED " << test.name << ": " << e.what() << endl;
+			failed++;
+		}
+	}
+	return failed > 0 ? 1 : 0;
+}